@@ -31,11 +31,20 @@ struct player_gcd_event_t : public player_event_t
           i < p() -> active_off_gcd_list -> off_gcd_actions.end(); ++i )
     {
       action_t* a = *i;
-      if ( a -> ready() )
+      bool ready;
+      {
+        cpu_profile_scope_t profile( sim(), a -> cpu_profile, cpu_profile_t::READY );
+        ready = a -> ready();
+      }
+
+      if ( ready )
       {
         action_priority_list_t* alist = p() -> active_action_list;
 
-        a -> execute();
+        {
+          cpu_profile_scope_t profile( sim(), a -> cpu_profile, cpu_profile_t::EXECUTE );
+          a -> execute();
+        }
         a -> line_cooldown.start();
         if ( ! a -> quiet )
         {
@@ -122,6 +131,7 @@ struct action_execute_event_t : public player_event_t
 
     if ( !target -> is_sleeping() )
     {
+      cpu_profile_scope_t profile( sim(), action -> cpu_profile, cpu_profile_t::EXECUTE );
       action -> execute();
     }
 
@@ -1293,6 +1303,7 @@ void action_t::execute()
     // New callback system; proc abilities on execute. 
     if ( callbacks )
     {
+      cpu_profile_scope_t profile( *sim, cpu_profile, cpu_profile_t::CALLBACKS );
       proc_types pt = execute_state -> proc_type();
       proc_types2 pt2 = execute_state -> execute_proc_type2();
 
@@ -1654,6 +1665,7 @@ void action_t::assess_damage( dmg_e    type,
 
   if ( callbacks )
   {
+    cpu_profile_scope_t profile( *sim, cpu_profile, cpu_profile_t::CALLBACKS );
     proc_types pt = s -> proc_type();
     proc_types2 pt2 = s -> impact_proc_type2();
     if ( pt != PROC1_INVALID && pt2 != PROC2_INVALID )
@@ -1949,8 +1961,12 @@ bool action_t::ready()
   if ( rng().roll( false_positive_pct() ) )
     return true;
 
-  if ( if_expr && !if_expr -> success() )
-    return false;
+  if ( if_expr )
+  {
+    cpu_profile_scope_t profile( *sim, cpu_profile, cpu_profile_t::CONDITION );
+    if ( ! if_expr -> success() )
+      return false;
+  }
 
   return true;
 }
@@ -3043,7 +3059,10 @@ void action_t::do_schedule_travel( action_state_t* state, const timespan_t& time
 {
   if ( time_ <= timespan_t::zero() )
   {
-    impact( state );
+    {
+      cpu_profile_scope_t profile( *sim, cpu_profile, cpu_profile_t::IMPACT );
+      impact( state );
+    }
     action_state_t::release( state );
   }
   else
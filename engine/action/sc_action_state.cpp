@@ -209,7 +209,10 @@ travel_event_t::travel_event_t( action_t* a,
 void travel_event_t::execute()
 {
   if ( ! state -> target -> is_sleeping() )
+  {
+    cpu_profile_scope_t profile( sim(), action -> cpu_profile, cpu_profile_t::IMPACT );
     action -> impact( state );
+  }
   action_state_t::release( state );
   action -> remove_travel_event( this );
 }
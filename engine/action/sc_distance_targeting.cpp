@@ -5,6 +5,14 @@
 
 #include "simulationcraft.hpp"
 
+namespace { // UNNAMED NAMESPACE ==========================================
+
+// Same test as the distance targeting checks have always used
+bool in_area( player_t& p, double x, double y, double radius )
+{ return ! ( p.get_position_distance( x, y ) > radius ); }
+
+} // UNNAMED NAMESPACE ====================================================
+
 /* 
  This file contains all functions that treat targets as if they were on an x,y plane with coordinates other than 0,0.
  The simulation flag distance_targeting_enabled must be turned on for these to do anything.
@@ -38,25 +46,64 @@
 
   std::vector<player_t*> action_t::targets_in_range_list( std::vector< player_t* >& tl ) const
   {
-    size_t i = tl.size();
-    while ( i > 0 )
+    spatial_index_t& index = sim -> spatial_index;
+    if ( range > 0.0 )
+      index.query( player -> x_position, player -> y_position, range );
+
+    size_t n = 0;
+    for ( size_t i = 0; i < tl.size(); i++ )
     {
-      i--;
       player_t* target_ = tl[i];
-      if ( range > 0.0 && target_ -> get_player_distance( *player ) > range )
-        tl.erase( tl.begin() + i );
+      if ( range > 0.0 && ! index.hit( *target_ ) )
+        continue;
       else if ( !ground_aoe && target_ -> debuffs.invulnerable -> check() ) // Cannot target invulnerable mobs, unless it's a ground aoe. It just won't do damage.
-        tl.erase( tl.begin() + i );
+        continue;
+      tl[ n++ ] = target_;
     }
+    tl.resize( n );
     return tl;
   }
 
   std::vector<player_t*> action_t::check_distance_targeting( std::vector< player_t* >& tl ) const
   {
-    size_t i = tl.size();
-    while ( i > 0 )
+    // Find the area every target other than the main one has to be in, and
+    // the targets in it.
+    double x = 0, y = 0, area = 0;
+    if ( radius > 0 && range > 0 )
+    { // Abilities with range/radius radiate from the target. 
+      area = radius;
+      if ( ground_aoe && parent_dot && parent_dot -> is_ticking() )
+      { // We need to check the parents dot for location.
+        if ( sim -> log )
+          sim -> out_debug.printf( "parent_dot location: x=%.3f,y%.3f", parent_dot -> state -> original_x, parent_dot -> state -> original_y );
+        x = parent_dot -> state -> original_x;
+        y = parent_dot -> state -> original_y;
+      }
+      else if ( ground_aoe && execute_state )
+      { // We should just check the child.
+        x = execute_state -> original_x;
+        y = execute_state -> original_y;
+      }
+      else
+      {
+        x = target -> x_position;
+        y = target -> y_position;
+      }
+    } // If they do not have a range, they are likely based on the distance from the player.
+    else if ( radius > 0 || range > 0 )
+    { // If they only have a range, then they are a single target ability, or are also based on the distance from the player.
+      area = radius > 0 ? radius : range;
+      x = player -> x_position;
+      y = player -> y_position;
+    }
+
+    spatial_index_t& index = sim -> spatial_index;
+    if ( area > 0 )
+      index.query( x, y, area );
+
+    size_t n = 0;
+    for ( size_t i = 0; i < tl.size(); i++ )
     {
-      i--;
       player_t* t = tl[i];
       if ( t != target )
       {
@@ -67,30 +114,14 @@
             player -> x_position, player -> y_position, target -> name(), target -> x_position, target -> y_position, t -> name(), t -> x_position, t -> y_position );
         }
         if ( ( ground_aoe && t -> debuffs.flying -> check() ) || t -> debuffs.invulnerable -> check() )
-          tl.erase( tl.begin() + i );
-        else if ( radius > 0 && range > 0 )
-        { // Abilities with range/radius radiate from the target. 
-          if ( ground_aoe && parent_dot && parent_dot -> is_ticking() )
-          { // We need to check the parents dot for location.
-            if ( sim -> log )
-              sim -> out_debug.printf( "parent_dot location: x=%.3f,y%.3f", parent_dot -> state -> original_x, parent_dot -> state -> original_y );
-            if ( t -> get_ground_aoe_distance( *parent_dot -> state ) > radius )
-              tl.erase( tl.begin() + i );
-          }
-          else if ( ground_aoe && execute_state )
-          {
-            if ( t -> get_ground_aoe_distance( *execute_state ) > radius )
-              tl.erase( tl.begin() + i ); // We should just check the child.
-          }
-          else if ( t -> get_player_distance( *target ) > radius )
-            tl.erase( tl.begin() + i );
-        } // If they do not have a range, they are likely based on the distance from the player.
-        else if ( radius > 0 && t -> get_player_distance( *player ) > radius )
-          tl.erase( tl.begin() + i );
-        else if ( range > 0 && t -> get_player_distance( *player ) > range )
-          tl.erase( tl.begin() + i ); // If they only have a range, then they are a single target ability, or are also based on the distance from the player.
+          continue;
+        if ( area > 0 && ! index.hit( *t ) )
+          continue;
       }
+      tl[ n++ ] = t;
     }
+    tl.resize( n );
+
     if ( sim -> log )
     {
       sim -> out_debug.printf( "%s regenerated target cache for %s (%s)",
@@ -220,6 +251,15 @@ double player_t::get_ground_aoe_distance( action_state_t& a )
   return get_position_distance( a.original_x, a.original_y );
 }
 
+// player_t::set_position ======================================================
+
+void player_t::set_position( double x, double y )
+{
+  x_position = x;
+  y_position = y;
+  sim -> spatial_index.update( *this );
+}
+
 // player_t::init_distance_targeting ===========================================
 
 void player_t::init_distance_targeting()
@@ -230,6 +270,165 @@ void player_t::init_distance_targeting()
   x_position = -1 * base.distance;
 }
 
+// Spatial index ================================================================
+
+const uint64_t spatial_index_t::NO_CELL;
+
+spatial_index_t::spatial_index_t( sim_t& s ) :
+  sim( s ), cell_size( 10.0 ), query_stamp( 0 ),
+  query_x( 0 ), query_y( 0 ), query_radius( 0 )
+{
+}
+
+// spatial_index_t::grow ========================================================
+
+void spatial_index_t::grow( const player_t& p )
+{
+  if ( p.actor_index >= actor_cell.size() )
+  {
+    actor_cell.resize( p.actor_index + 1, NO_CELL );
+    actor_stamp.resize( p.actor_index + 1, 0 );
+  }
+}
+
+// spatial_index_t::clear =======================================================
+
+void spatial_index_t::clear()
+{
+  cells.clear();
+  std::fill( actor_cell.begin(), actor_cell.end(), NO_CELL );
+}
+
+// spatial_index_t::insert ======================================================
+
+void spatial_index_t::insert( player_t& p )
+{
+  grow( p );
+  if ( actor_cell[ p.actor_index ] != NO_CELL )
+    return;
+
+  uint64_t key = cell_key( cell( p.x_position ), cell( p.y_position ) );
+  cells[ key ].push_back( &p );
+  actor_cell[ p.actor_index ] = key;
+}
+
+// spatial_index_t::remove ======================================================
+
+void spatial_index_t::remove( player_t& p )
+{
+  if ( p.actor_index >= actor_cell.size() || actor_cell[ p.actor_index ] == NO_CELL )
+    return;
+
+  auto it = cells.find( actor_cell[ p.actor_index ] );
+  assert( it != cells.end() );
+  auto& actors = it -> second;
+  actors.erase( std::find( actors.begin(), actors.end(), &p ) );
+  if ( actors.empty() )
+    cells.erase( it );
+
+  actor_cell[ p.actor_index ] = NO_CELL;
+}
+
+// spatial_index_t::update ======================================================
+
+void spatial_index_t::update( player_t& p )
+{
+  if ( p.actor_index >= actor_cell.size() || actor_cell[ p.actor_index ] == NO_CELL )
+    return;
+
+  if ( cell_key( cell( p.x_position ), cell( p.y_position ) ) == actor_cell[ p.actor_index ] )
+    return;
+
+  remove( p );
+  insert( p );
+}
+
+// spatial_index_t::query =======================================================
+
+/* Marks the indexed actors within radius of x,y as hit, optionally appending
+ * them to out in no particular order. Returns the number of actors hit.
+ */
+size_t spatial_index_t::query( double x, double y, double radius, std::vector<player_t*>* out )
+{
+  query_x = x;
+  query_y = y;
+  query_radius = radius;
+
+  if ( ++query_stamp == 0 )
+  {
+    std::fill( actor_stamp.begin(), actor_stamp.end(), 0 );
+    query_stamp = 1;
+  }
+
+  size_t n = 0;
+  auto visit = [ this, &n, out, x, y, radius ]( const std::vector<player_t*>& actors ) {
+    for ( size_t i = 0; i < actors.size(); i++ )
+    {
+      player_t* p = actors[ i ];
+      if ( ! in_area( *p, x, y, radius ) )
+        continue;
+
+      actor_stamp[ p -> actor_index ] = query_stamp;
+      n++;
+      if ( out )
+        out -> push_back( p );
+    }
+  };
+
+  // get_position_distance is an approximation. util::approx_sqrt ( one Newton
+  // step of the inverse square root ) underestimates by at most 0.18%, so an
+  // actor it accepts is truly within radius * 1.0018. The slack around the
+  // radius when picking the cells to search has to stay above that bound.
+  double slack = radius * 1.01 + 0.01;
+  int32_t x0 = cell( x - slack ), x1 = cell( x + slack );
+  int32_t y0 = cell( y - slack ), y1 = cell( y + slack );
+
+  // Walking the covered cells only pays off while there are fewer of them
+  // than occupied ones
+  if ( ( x1 - x0 + 1.0 ) * ( y1 - y0 + 1.0 ) > cells.size() )
+  {
+    for ( const auto& c : cells )
+      visit( c.second );
+    return n;
+  }
+
+  for ( int32_t cx = x0; cx <= x1; cx++ )
+  {
+    for ( int32_t cy = y0; cy <= y1; cy++ )
+    {
+      auto it = cells.find( cell_key( cx, cy ) );
+      if ( it != cells.end() )
+        visit( it -> second );
+    }
+  }
+
+#ifndef NDEBUG
+  // The cells searched have to hold every actor the distance test accepts
+  size_t in_range = 0;
+  for ( const auto& c : cells )
+  {
+    for ( size_t i = 0; i < c.second.size(); i++ )
+      in_range += in_area( *c.second[ i ], x, y, radius );
+  }
+  assert( in_range == n && "spatial_index_t::query missed actors in range" );
+#endif
+
+  return n;
+}
+
+// spatial_index_t::hit =========================================================
+
+/* Whether the actor is in the area of the last query. Actors that are not
+ * indexed, like sleeping ones some actions still target, are measured.
+ */
+bool spatial_index_t::hit( player_t& p ) const
+{
+  if ( p.actor_index < actor_cell.size() && actor_cell[ p.actor_index ] != NO_CELL )
+    return actor_stamp[ p.actor_index ] == query_stamp;
+
+  return in_area( p, query_x, query_y, query_radius );
+}
+
 // Generic helper functions ==================================================
 
 // Approximation of square root ==============================================
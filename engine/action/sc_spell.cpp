@@ -430,6 +430,7 @@ void heal_t::assess_damage( dmg_e heal_type,
   // override action_t::proc_type() instead
   if ( callbacks )
   {
+    cpu_profile_scope_t profile( *sim, cpu_profile, cpu_profile_t::CALLBACKS );
     proc_types pt = s -> proc_type();
     proc_types2 pt2 = s -> impact_proc_type2();
     if ( pt != PROC1_INVALID && pt2 != PROC2_INVALID )
@@ -201,6 +201,9 @@ void stats_t::datacollection_begin()
   iteration_total_execute_time = timespan_t::zero();
   iteration_total_tick_time = timespan_t::zero();
 
+  // Size the timeline once for the expected fight length, see sc_timeline_t::reserve()
+  timeline_amount.reserve( timespan_t::from_seconds( sim.expected_max_time() ) );
+
   for ( result_e i = RESULT_NONE; i < RESULT_MAX; i++ )
   {
     direct_results[ i ].datacollection_begin();
@@ -152,6 +152,7 @@ buff_t::buff_t( const buff_creation::buff_creator_basics_t& params ) :
   requires_invalidation(),
   current_value(),
   current_stack(),
+  version( 0 ),
   buff_duration( timespan_t() ),
   default_chance( 1.0 ),
   buff_period( timespan_t::min() ),
@@ -693,6 +694,7 @@ void buff_t::decrement( int    stacks,
       stack_uptime[ current_stack ] -> update( false, sim -> current_time() );
 
     current_stack -= stacks;
+    version++;
 
     if ( value == DEFAULT_VALUE() && default_value != DEFAULT_VALUE() )
       value = default_value;
@@ -714,6 +716,8 @@ void buff_t::extend_duration( player_t* p, timespan_t extra_seconds )
 {
   assert( expiration );
 
+  version++;
+
   if ( extra_seconds > timespan_t::zero() )
   {
     expiration -> reschedule( expiration -> remains() + extra_seconds );
@@ -887,6 +891,7 @@ void buff_t::bump( int stacks, double value )
   if ( _max_stack == 0 ) return;
 
   current_value = value;
+  version++;
 
   if ( requires_invalidation ) invalidate_cache();
 
@@ -1031,6 +1036,7 @@ void buff_t::expire( timespan_t delay )
   }
 
   current_stack = 0;
+  version++;
   if ( requires_invalidation ) invalidate_cache();
   if ( last_start >= timespan_t::zero() )
   {
@@ -1305,6 +1311,14 @@ expr_t* buff_t::create_expression(  std::string buff_name,
       }
       return buff;
     }
+
+    // The stack of a fixed buff only changes along with its version
+    bool stack_dependencies( expr_deps_t& deps )
+    {
+      if ( ! static_buff ) return false;
+      deps.versions.push_back( &static_buff -> version );
+      return true;
+    }
   };
 
   if ( type == "duration" )
@@ -1344,6 +1358,14 @@ expr_t* buff_t::create_expression(  std::string buff_name,
       up_expr_t( std::string bn, action_t* a, buff_t* b ) :
         buff_expr_t( "buff_up", bn, a, b ) {}
       virtual double evaluate() { return buff() -> check() > 0; }
+      virtual bool range( double& min, double& max ) { min = 0; max = 1; return true; }
+      virtual bool slot( expr_slot_t& s )
+      {
+        if ( ! static_buff || ! s.set( static_buff -> current_stack ) ) return false;
+        s.compare = TOK_GT;
+        return true;
+      }
+      virtual bool dependencies( expr_deps_t& d ) { return stack_dependencies( d ); }
     };
     return new up_expr_t( buff_name, action, static_buff );
   }
@@ -1354,6 +1376,14 @@ expr_t* buff_t::create_expression(  std::string buff_name,
       down_expr_t( std::string bn, action_t* a, buff_t* b ) :
         buff_expr_t( "buff_down", bn, a, b ) {}
       virtual double evaluate() { return buff() -> check() <= 0; }
+      virtual bool range( double& min, double& max ) { min = 0; max = 1; return true; }
+      virtual bool slot( expr_slot_t& s )
+      {
+        if ( ! static_buff || ! s.set( static_buff -> current_stack ) ) return false;
+        s.compare = TOK_LTEQ;
+        return true;
+      }
+      virtual bool dependencies( expr_deps_t& d ) { return stack_dependencies( d ); }
     };
     return new down_expr_t( buff_name, action, static_buff );
   }
@@ -1364,6 +1394,16 @@ expr_t* buff_t::create_expression(  std::string buff_name,
       stack_expr_t( std::string bn, action_t* a, buff_t* b ) :
         buff_expr_t( "buff_stack", bn, a, b ) {}
       virtual double evaluate() { return buff() -> check(); }
+      virtual bool slot( expr_slot_t& s )
+      { return static_buff && s.set( static_buff -> current_stack ); }
+      virtual bool dependencies( expr_deps_t& d ) { return stack_dependencies( d ); }
+      virtual bool range( double& min, double& max )
+      {
+        if ( ! static_buff ) return false;
+        min = 0;
+        max = static_buff -> max_stack() >= 0 ? static_buff -> max_stack() : std::numeric_limits<double>::infinity();
+        return true;
+      }
     };
     return new stack_expr_t( buff_name, action, static_buff );
   }
@@ -1577,6 +1617,7 @@ void stat_buff_t::decrement( int stacks, double /* value */ )
       stats[ i ].current_value -= delta;
     }
     current_stack -= stacks;
+    version++;
 
     invalidate_cache();
 
@@ -1669,6 +1710,7 @@ void cost_reduction_buff_t::decrement( int stacks, double /* value */ )
     double delta = amount * stacks;
     player -> cost_reduction_loss( school, delta );
     current_stack -= stacks;
+    version++;
     current_value -= delta;
   }
 }
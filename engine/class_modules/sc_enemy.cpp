@@ -1223,7 +1223,7 @@ void enemy_t::create_buffs()
 
 void enemy_t::init_resources( bool /* force */ )
 {
-  double health_adjust = sim -> iteration_time_adjust();
+  double health_adjust = sim -> iteration_health_adjust();
 
   resources.base[ RESOURCE_HEALTH ] = initial_health * health_adjust;
 
@@ -1484,6 +1484,11 @@ void enemy_t::recalculate_health()
 {
   if ( sim -> expected_iteration_time <= timespan_t::zero() || fixed_health > 0 ) return;
 
+  // Deterministic sims only calibrate health in the warm-up iteration, which
+  // all threads run the same way, so health does not depend on which
+  // iterations a thread ran.
+  if ( sim -> deterministic && sim -> current_index >= 0 ) return;
+
   if ( initial_health == 0 ) // first iteration
   {
     initial_health = iteration_dmg_taken * ( sim -> expected_iteration_time / sim -> current_time() ) * ( 1.0 / ( 1.0 - death_pct / 100 ) );
@@ -932,6 +932,8 @@ void player_t::init_base_stats()
       collected_data.dtps.change_mode( false );
   }
 
+  collected_data.init_quantile_sketches( *sim );
+
   if ( sim -> debug )
     sim -> out_debug.printf( "%s: Generic Base Stats: %s", name(), base.to_string().c_str() );
 
@@ -3587,6 +3589,8 @@ void player_t::datacollection_begin()
   range::fill( iteration_resource_lost, 0 );
   range::fill( iteration_resource_gained, 0 );
 
+  collected_data.reserve_timelines( *this );
+
   if ( collected_data.health_changes.collect )
   {
     collected_data.health_changes.timeline.clear(); // Drop Data
@@ -3895,6 +3899,7 @@ void player_t::merge( player_t& other )
     if ( action_list[ i ] -> internal_id == other.action_list[ i ] -> internal_id )
     {
       action_list[ i ] -> total_executions += other.action_list[ i ] -> total_executions;
+      action_list[ i ] -> cpu_profile.merge( other.action_list[ i ] -> cpu_profile );
     }
     else
     {
@@ -4168,6 +4173,9 @@ void player_t::arise()
     sim -> player_non_sleeping_list.push_back( this );
   }
 
+  if ( sim -> distance_targeting_enabled )
+    sim -> spatial_index.insert( *this );
+
   if ( has_foreground_actions( *this ) )
     schedule_ready();
 
@@ -4260,6 +4268,8 @@ void player_t::demise()
     sim -> player_non_sleeping_list.find_and_erase_unordered( this );
   }
 
+  sim -> spatial_index.remove( *this );
+
   current.sleeping = true;
 }
 
@@ -8104,6 +8114,9 @@ expr_t* player_t::create_expression( action_t* a,
   // race
   if ( splits[ 0 ] == "race" && splits.size() == 2 )
   {
+    if ( sim -> optimize_expressions )
+      return expr_t::create_constant( expression_str, race_str == splits[ 1 ] );
+
     struct race_expr_t : public expr_t
     {
       player_t& player;
@@ -8119,6 +8132,9 @@ expr_t* player_t::create_expression( action_t* a,
   // role
   if ( splits[ 0 ] == "role" && splits.size() == 2 )
   {
+    if ( sim -> optimize_expressions )
+      return expr_t::create_constant( expression_str, util::str_compare_ci( util::role_type_string( primary_role() ), splits[ 1 ] ) );
+
     struct role_expr_t : public expr_t
     {
       player_t& player;
@@ -9490,6 +9506,45 @@ scaling_metric_data_t player_t::scaling_for_metric( scale_metric_e metric ) cons
   }
 }
 
+/* Per iteration samples of a scale metric, together with the iteration index
+ * of each sample ( common random numbers ). Returns nullptr for metrics
+ * combined from several samples.
+ */
+const extended_sample_data_t* player_t::scaling_sample_data( scale_metric_e metric, const std::vector<int>*& iteration_index ) const
+{
+  const player_t* q = nullptr;
+  if ( ! sim -> scaling -> scale_over_player.empty() )
+    q = sim -> find_player( sim -> scaling -> scale_over_player );
+  if ( !q )
+    q = this;
+
+  iteration_index = &q -> collected_data.iteration_index;
+
+  switch ( metric )
+  {
+    case SCALE_METRIC_DPS:        return &q -> collected_data.dps;
+    case SCALE_METRIC_DPSE:       return &q -> collected_data.dpse;
+    case SCALE_METRIC_HPS:        return &q -> collected_data.hps;
+    case SCALE_METRIC_HPSE:       return &q -> collected_data.hpse;
+    case SCALE_METRIC_APS:        return &q -> collected_data.aps;
+    case SCALE_METRIC_DPSP:       return &q -> collected_data.prioritydps;
+    case SCALE_METRIC_HAPS:       return nullptr;
+    case SCALE_METRIC_DTPS:       return &q -> collected_data.dtps;
+    case SCALE_METRIC_DMG_TAKEN:  return &q -> collected_data.dmg_taken;
+    case SCALE_METRIC_HTPS:       return &q -> collected_data.htps;
+    case SCALE_METRIC_TMI:        return &q -> collected_data.theck_meloree_index;
+    case SCALE_METRIC_ETMI:       return &q -> collected_data.effective_theck_meloree_index;
+    case SCALE_METRIC_DEATHS:     return nullptr;
+    default:
+      if ( q -> primary_role() == ROLE_TANK )
+        return &q -> collected_data.dtps;
+      else if ( q -> primary_role() == ROLE_HEAL )
+        return nullptr;
+      else
+        return &q -> collected_data.dps;
+  }
+}
+
 // Change the player position ( fron/back, etc. ) and update attack hit table
 
 void player_t::change_position( position_e new_pos )
@@ -10227,6 +10282,37 @@ player_collected_data_t::player_collected_data_t( const std::string& player_name
   buffed_stats_snapshot()
 { }
 
+/* Switch the metrics listed in the quantile_sketch option ( or all of them
+ * for quantile_sketch=all ) to sketch mode, trading exact percentiles and
+ * access to the raw samples for bounded memory and cheap merges.
+ */
+void player_collected_data_t::init_quantile_sketches( const sim_t& sim )
+{
+  if ( sim.quantile_sketch_str.empty() )
+    return;
+
+  std::pair<const char*, extended_sample_data_t*> metrics[] = {
+    { "fight_length", &fight_length },
+    { "dmg", &dmg }, { "dps", &dps }, { "dpse", &dpse }, { "prioritydps", &prioritydps },
+    { "dtps", &dtps }, { "dmg_taken", &dmg_taken },
+    { "heal", &heal }, { "hps", &hps }, { "hpse", &hpse }, { "htps", &htps }, { "heal_taken", &heal_taken },
+    { "absorb", &absorb }, { "aps", &aps }, { "atps", &atps }, { "absorb_taken", &absorb_taken },
+    { "deaths", &deaths }, { "tmi", &theck_meloree_index }, { "etmi", &effective_theck_meloree_index },
+    { "max_spike", &max_spike_amount }
+  };
+
+  double accuracy = clamp( sim.quantile_sketch_accuracy, 0.0001, 0.1 );
+  std::vector<std::string> names = util::string_split( sim.quantile_sketch_str, ",:;/|" );
+  for ( size_t i = 0; i < names.size(); ++i )
+  {
+    for ( size_t j = 0; j < sizeof_array( metrics ); ++j )
+    {
+      if ( names[ i ] == "all" || util::str_compare_ci( names[ i ], metrics[ j ].first ) )
+        metrics[ j ].second -> use_sketch( accuracy );
+    }
+  }
+}
+
 void player_collected_data_t::reserve_memory( const player_t& p )
 {
   int size = std::min( p.sim -> iterations, 10000 );
@@ -10255,6 +10341,44 @@ void player_collected_data_t::reserve_memory( const player_t& p )
   }
 }
 
+/* Preallocate the timelines filled during combat up to the expected maximum
+ * fight length, so that adding to them does not reallocate. Only iterations
+ * running past the expected length take the slow path of timeline_t::add().
+ */
+void player_collected_data_t::reserve_timelines( const player_t& p )
+{
+  timespan_t max_time = timespan_t::from_seconds( p.sim -> expected_max_time() );
+
+  timeline_dmg_taken.reserve( max_time );
+  timeline_healing_taken.reserve( max_time );
+  for ( auto& elem : resource_timelines )
+    elem.timeline.reserve( max_time );
+  for ( auto& elem : stat_timelines )
+    elem.timeline.reserve( max_time );
+  if ( health_changes.collect )
+  {
+    health_changes.timeline.reserve( max_time );
+    health_changes.timeline_normalized.reserve( max_time );
+  }
+  if ( health_changes_tmi.collect )
+  {
+    health_changes_tmi.timeline.reserve( max_time );
+    health_changes_tmi.timeline_normalized.reserve( max_time );
+  }
+}
+
+// Number of timeline additions which had to grow past the reserved storage
+
+size_t player_collected_data_t::timeline_overflows() const
+{
+  size_t count = timeline_dmg_taken.overflow_count() + timeline_healing_taken.overflow_count();
+  for ( const auto& elem : resource_timelines )
+    count += elem.timeline.overflow_count();
+  for ( const auto& elem : stat_timelines )
+    count += elem.timeline.overflow_count();
+  return count;
+}
+
 void player_collected_data_t::merge( const player_collected_data_t& other )
 {
   fight_length.merge( other.fight_length );
@@ -10281,6 +10405,8 @@ void player_collected_data_t::merge( const player_collected_data_t& other )
   timeline_healing_taken.merge( other.timeline_healing_taken );
   theck_meloree_index.merge( other.theck_meloree_index );
   effective_theck_meloree_index.merge( other.effective_theck_meloree_index );
+  target_metric.merge( other.target_metric );
+  iteration_index.insert( iteration_index.end(), other.iteration_index.begin(), other.iteration_index.end() );
 
   for ( resource_e i = RESOURCE_NONE; i < RESOURCE_MAX; ++i )
   {
@@ -10339,6 +10465,7 @@ void player_collected_data_t::analyze( const player_t& p )
   theck_meloree_index.analyze_all();
   effective_theck_meloree_index.analyze_all();
   max_spike_amount.analyze_all();
+  target_metric.analyze_all();
 
   for ( size_t i = 0; i <  resource_timelines.size(); ++i )
   {
@@ -10465,6 +10592,9 @@ void player_collected_data_t::collect_data( const player_t& p )
   fight_length.add( f_length );
   waiting_time.add( w_time );
 
+  if ( p.sim -> scaling -> common_random_numbers )
+    iteration_index.push_back( p.sim -> current_index );
+
   executed_foreground_actions.add( p.iteration_executed_foreground_actions );
 
   // Player only dmg/heal
@@ -10586,11 +10716,8 @@ void player_collected_data_t::collect_data( const player_t& p )
     default:;
     }
 
-    player_collected_data_t& cd = p.parent ? p.parent -> collected_data : *this;
-
-    cd.target_metric_mutex.lock();
-    cd.target_metric.add( metric );
-    cd.target_metric_mutex.unlock();
+    // Thread local, pooled across threads by sim_t::convergence_monitor_t and merged at the end
+    target_metric.add( metric );
   }
 }
 
@@ -10975,7 +11102,13 @@ action_t* player_t::select_action( const action_priority_list_t& list )
     if ( a -> wait_on_ready == 1 )
       break;
 
-    if ( a -> ready() )
+    bool ready;
+    {
+      cpu_profile_scope_t profile( *sim, a -> cpu_profile, cpu_profile_t::READY );
+      ready = a -> ready();
+    }
+
+    if ( ready )
     {
       if ( a -> type != ACTION_CALL )
         return a;
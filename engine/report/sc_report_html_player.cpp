@@ -1809,6 +1809,25 @@ void print_html_player_scale_factor_table( report::sc_html_stream& os, const sim
     p.scaling_lag_error[ sm ] );
   os << "</tr>\n";
 
+  if ( p.sim -> scaling -> common_random_numbers )
+  {
+    os << "<tr>\n"
+      << "<th class=\"left\">Correlation</th>\n";
+    for ( const auto& stat : scaling_stats )
+      os.format( "<td>%.3f</td>\n", p.scaling_correlation[ sm ].get_stat( stat ) );
+    if ( p.sim -> scaling -> scale_lag )
+      os << "<td></td>\n";
+    os << "</tr>\n";
+
+    os << "<tr>\n"
+      << "<th class=\"left\">Iteration Savings</th>\n";
+    for ( const auto& stat : scaling_stats )
+      os.format( "<td>%.1fx</td>\n", p.scaling_variance_reduction[ sm ].get_stat( stat ) );
+    if ( p.sim -> scaling -> scale_lag )
+      os << "<td></td>\n";
+    os << "</tr>\n";
+  }
+
   os.format(
     "<tr class=\"left\">\n"
     "<th>Gear Ranking</th>\n"
@@ -2272,6 +2291,84 @@ void print_html_player_action_priority_list( report::sc_html_stream& os, const p
 
 }
 
+// print_html_player_cpu_profile ============================================
+
+void print_html_player_cpu_profile( report::sc_html_stream& os, const player_t& p )
+{
+  if ( p.sim -> profile_cpu <= 0 )
+    return;
+
+  std::vector<const action_t*> actions;
+  double total = 0;
+  for ( size_t i = 0; i < p.action_list.size(); ++i )
+  {
+    const action_t* a = p.action_list[ i ];
+    if ( a -> cpu_profile.total() <= 0 ) continue;
+    actions.push_back( a );
+    total += a -> cpu_profile.total();
+  }
+
+  if ( actions.empty() )
+    return;
+
+  range::sort( actions, []( const action_t* l, const action_t* r )
+  { return l -> cpu_profile.total() > r -> cpu_profile.total(); } );
+
+  os << "<div class=\"player-section cpu-profile\">\n"
+     << "<h3 class=\"toggle\">CPU Profile</h3>\n"
+     << "<div class=\"toggle-content hide\">\n";
+
+  os.format( "<p>Estimated wall clock time in milliseconds, one in every %d calls timed. "
+             "Times are inclusive, click a column header to sort.</p>\n", p.sim -> profile_cpu );
+
+  os << "<table class=\"sc sortable\">\n"
+     << "<tr>\n"
+     << "<th class=\"left\">action</th>\n"
+     << "<th class=\"left\">list</th>\n";
+  for ( cpu_profile_t::part_e i = cpu_profile_t::READY; i < cpu_profile_t::PART_MAX; i = static_cast<cpu_profile_t::part_e>( i + 1 ) )
+  {
+    os.format( "<th class=\"right\">%s</th>\n", cpu_profile_t::part_name( i ) );
+  }
+  os << "<th class=\"right\">total</th>\n"
+     << "<th class=\"right\">%</th>\n"
+     << "</tr>\n";
+
+  for ( size_t i = 0; i < actions.size(); ++i )
+  {
+    const action_t* a = actions[ i ];
+
+    os << "<tr";
+    if ( i & 1 )
+    {
+      os << " class=\"odd\"";
+    }
+    os << ">\n";
+
+    os.format( "<td class=\"left\" title=\"%s\">%s</td>\n"
+               "<td class=\"left\">%s</td>\n",
+               util::encode_html( a -> signature_str ).c_str(),
+               util::encode_html( a -> name() ).c_str(),
+               a -> action_list ? util::encode_html( a -> action_list -> name_str ).c_str() : "" );
+
+    for ( cpu_profile_t::part_e j = cpu_profile_t::READY; j < cpu_profile_t::PART_MAX; j = static_cast<cpu_profile_t::part_e>( j + 1 ) )
+    {
+      os.format( "<td class=\"right\" title=\"%llu calls\">%.3f</td>\n",
+                 static_cast<unsigned long long>( a -> cpu_profile.parts[ j ].calls ),
+                 a -> cpu_profile.estimate( j ) * 1000.0 );
+    }
+
+    os.format( "<td class=\"right\">%.3f</td>\n"
+               "<td class=\"right\">%.2f</td>\n"
+               "</tr>\n",
+               a -> cpu_profile.total() * 1000.0,
+               100.0 * a -> cpu_profile.total() / total );
+  }
+
+  os << "</table>\n"
+     << "</div>\n"
+     << "</div>\n";
+}
+
 // print_html_player_statistics =============================================
 
 void print_html_player_statistics( report::sc_html_stream& os, const player_t& p, const player_processed_report_information_t& ri )
@@ -4369,6 +4466,8 @@ void print_html_player_( report::sc_html_stream& os, const player_t& p, int play
 
   print_html_player_action_priority_list( os, p );
 
+  print_html_player_cpu_profile( os, p );
+
   print_html_stats( os, p );
 
   print_html_gear( os, p );
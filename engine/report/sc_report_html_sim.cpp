@@ -456,6 +456,22 @@ void print_html_sim_summary( report::sc_html_stream& os, sim_t& sim, const sim_r
     "<td>%.4f</td>\n"
     "</tr>\n",
     sim.elapsed_time );
+  os.format(
+    "<tr class=\"left\">\n"
+    "<th>Merge Seconds:</th>\n"
+    "<td>%.4f</td>\n"
+    "</tr>\n",
+    sim.elapsed_merge_time );
+  if ( sim.convergence -> converged )
+  {
+    os.format(
+      "<tr class=\"left\">\n"
+      "<th>Target Error Reached:</th>\n"
+      "<td>after %d iterations, %d iterations saved</td>\n"
+      "</tr>\n",
+      sim.convergence -> converged_iterations.load(),
+      sim.convergence -> iterations_saved.load() );
+  }
   os.format(
     "<tr class=\"left\">\n"
     "<th>Speed Up:</th>\n"
@@ -1648,6 +1664,29 @@ void print_html_( report::sc_html_stream& os, sim_t& sim )
 
   print_html_image_load_scripts( os );
 
+  if ( sim.profile_cpu > 0 )
+  {
+    // Click to sort on the header of tables with the sortable class
+    os << "<script type=\"text/javascript\">\n"
+       << "jQuery(document).ready(function($) {\n"
+       << "\t$('table.sortable').each(function() {\n"
+       << "\t\tvar table = $(this);\n"
+       << "\t\ttable.find('tr:first th').css('cursor', 'pointer').click(function() {\n"
+       << "\t\t\tvar col = $(this).index(), desc = !$(this).data('desc');\n"
+       << "\t\t\t$(this).data('desc', desc);\n"
+       << "\t\t\tvar rows = table.find('tr').slice(1).get();\n"
+       << "\t\t\trows.sort(function(a, b) {\n"
+       << "\t\t\t\tvar x = $(a).children().eq(col).text(), y = $(b).children().eq(col).text();\n"
+       << "\t\t\t\tvar c = ( isNaN(parseFloat(x)) || isNaN(parseFloat(y)) ) ? x.localeCompare(y) : parseFloat(x) - parseFloat(y);\n"
+       << "\t\t\t\treturn desc ? -c : c;\n"
+       << "\t\t\t});\n"
+       << "\t\t\t$.each(rows, function(i, row) { $(row).parent().append(row); $(row).toggleClass('odd', ( i & 1 ) == 1); });\n"
+       << "\t\t});\n"
+       << "\t});\n"
+       << "});\n"
+       << "</script>\n";
+  }
+
   if ( num_players > 1 )
     print_html_raid_imagemaps( os, sim, sim.report_information );
 
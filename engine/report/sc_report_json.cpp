@@ -252,6 +252,27 @@ js::sc_js_t to_json( const stats_t& s )
   return node;
 }
 
+js::sc_js_t cpu_profile_to_json( const action_t& a )
+{
+  js::sc_js_t node;
+  node.set( "name", a.name() );
+  if ( a.action_list )
+    node.set( "action_list", a.action_list -> name_str );
+  node.set( "signature", a.signature_str );
+  node.set( "total", a.cpu_profile.total() );
+  for ( cpu_profile_t::part_e i = cpu_profile_t::READY; i < cpu_profile_t::PART_MAX; i = static_cast<cpu_profile_t::part_e>( i + 1 ) )
+  {
+    const cpu_profile_t::part_t& part = a.cpu_profile.parts[ i ];
+    js::sc_js_t pnode;
+    pnode.set( "calls", part.calls );
+    pnode.set( "samples", part.samples );
+    pnode.set( "sampled_time", part.time );
+    pnode.set( "time", a.cpu_profile.estimate( i ) );
+    node.set( cpu_profile_t::part_name( i ), pnode );
+  }
+  return node;
+}
+
 js::sc_js_t to_json( const player_collected_data_t::resource_timeline_t& rtl )
 {
   js::sc_js_t node;
@@ -606,6 +627,14 @@ js::sc_js_t to_json( const player_t& p )
   {
     node.add( "stats", to_json( *stat ) );
   }
+  if ( p.sim -> profile_cpu > 0 )
+  {
+    for ( const auto& action : p.action_list )
+    {
+      if ( action -> cpu_profile.total() > 0 )
+        node.add( "cpu_profile", cpu_profile_to_json( *action ) );
+    }
+  }
   return node;
 }
 
@@ -705,6 +734,11 @@ js::sc_js_t to_json( const sim_t& sim )
   node.set( "vary_combat_length", sim.vary_combat_length );
   node.set( "iterations", sim.iterations );
   node.set( "target_error", sim.target_error );
+  if ( sim.convergence -> converged )
+  {
+    node.set( "converged_iterations", sim.convergence -> converged_iterations.load() );
+    node.set( "iterations_saved", sim.convergence -> iterations_saved.load() );
+  }
   for ( const auto& player : sim.player_no_pet_list.data() )
   {
     node.add( "players", to_json( *player ) );
@@ -736,6 +770,11 @@ js::sc_js_t to_json( const sim_t& sim )
   node.set( "ignite_sampling_delta", to_json( sim.ignite_sampling_delta ) );
   node.set( "fixed_time", sim.fixed_time );
   node.set( "optimize_expressions", sim.optimize_expressions );
+  node.set( "compile_expressions", sim.compile_expressions );
+  node.set( "incremental_expressions", sim.incremental_expressions );
+  node.set( "incremental_expressions_check", sim.incremental_expressions_check );
+  node.set( "optimize_action_lists", sim.optimize_action_lists );
+  node.set( "profile_cpu", sim.profile_cpu );
   node.set( "optimal_raid", sim.optimal_raid );
   node.set( "log", sim.log );
   node.set( "debug_each", sim.debug_each );
@@ -776,6 +815,7 @@ js::sc_js_t to_json( const sim_t& sim )
   node.set( "reforge_plot", to_json( *sim.reforge_plot ) );
   node.set( "elapsed_cpu", sim.elapsed_cpu );
   node.set( "elapsed_time", sim.elapsed_time );
+  node.set( "elapsed_merge_time", sim.elapsed_merge_time );
   node.set( "raid_dps", to_json( sim.raid_dps ) );
   node.set( "total_dmg", to_json( sim.total_dmg ) );
   node.set( "raid_hps", to_json( sim.raid_hps ) );
@@ -660,14 +660,32 @@ void print_text_performance( FILE* file, sim_t* sim )
   std::time_t cur_time = std::time( nullptr );
   char date_str[sizeof "2011-10-08 07:07:09"];
   std::strftime(date_str, sizeof date_str, "%Y-%m-%d %H:%M:%S", std::localtime(&cur_time));
+
+  // Timeline additions past the storage reserved for the expected fight length
+  size_t timeline_overflows = 0;
+  for ( size_t i = 0; i < sim -> player_list.size(); ++i )
+  {
+    const player_t* p = sim -> player_list[ i ];
+    timeline_overflows += p -> collected_data.timeline_overflows();
+    for ( size_t j = 0; j < p -> stats_list.size(); ++j )
+      timeline_overflows += p -> stats_list[ j ] -> timeline_amount.overflow_count();
+  }
+
   util::fprintf( file,
                  "\nBaseline Performance:\n"
                  "  RNG Engine    = %s%s\n"
                  "  Iterations    = %d\n"
                  "  TotalEvents   = %lu\n"
                  "  MaxEventQueue = %lu\n"
+                 "  EventQueue    = %s\n"
+                 "  EventsPerSec  = %.0f\n"
+                 "  Executed      = %llu\n"
+                 "  Canceled      = %llu unlinked, %llu tombstones\n"
 #ifdef EVENT_QUEUE_DEBUG
                  "  AllocEvents   = %u\n"
+                 "  Cascaded      = %llu\n"
+                 "  SlicesVisited = %llu\n"
+                 "  SlicesSkipped = %llu (%.3f per visit)\n"
                  "  EndInsert     = %u (%.3f%%)\n"
                  "  MaxQueueDepth = %u\n"
                  "  AvgQueueDepth = %.3f\n"
@@ -676,14 +694,25 @@ void print_text_performance( FILE* file, sim_t* sim )
                  "  SimSeconds    = %.0f\n"
                  "  CpuSeconds    = %.3f\n"
                  "  WallSeconds   = %.3f\n"
+                 "  MergeSeconds  = %.3f\n"
+                 "  TimelineGrows = %llu\n"
                  "  SpeedUp       = %.0f\n"
                  "  EndTime       = %s (%.0f)\n\n",
                  sim -> rng().name(), sim -> deterministic ? " (deterministic)" : "",
                  sim -> iterations,
                  sim -> event_mgr.total_events_processed,
                  sim -> event_mgr.max_events_remaining,
+                 sim -> event_mgr.wheel_overflow ? "timing wheel + overflow tier" : "timing wheel (legacy)",
+                 sim -> event_mgr.total_events_processed / sim -> elapsed_cpu,
+                 static_cast<unsigned long long>( sim -> event_mgr.total_events_executed ),
+                 static_cast<unsigned long long>( sim -> event_mgr.total_events_canceled ),
+                 static_cast<unsigned long long>( sim -> event_mgr.total_tombstones_processed ),
 #ifdef EVENT_QUEUE_DEBUG
                  sim -> event_mgr.n_allocated_events,
+                 static_cast<unsigned long long>( sim -> event_mgr.events_cascaded ),
+                 static_cast<unsigned long long>( sim -> event_mgr.slices_visited ),
+                 static_cast<unsigned long long>( sim -> event_mgr.slices_skipped ),
+                 static_cast<double>( sim -> event_mgr.slices_skipped ) / sim -> event_mgr.slices_visited,
                  sim -> event_mgr.n_end_insert,
                  100.0 * static_cast<double>( sim -> event_mgr.n_end_insert ) / sim -> event_mgr.events_added,
                  sim -> event_mgr.max_queue_depth,
@@ -693,9 +722,33 @@ void print_text_performance( FILE* file, sim_t* sim )
                  sim -> iterations * sim -> simulation_length.mean(),
                  sim -> elapsed_cpu,
                  sim -> elapsed_time,
+                 sim -> elapsed_merge_time,
+                 static_cast<unsigned long long>( timeline_overflows ),
                  sim -> iterations * sim -> simulation_length.mean() / sim -> elapsed_cpu,
                  date_str,
                  static_cast<double>( cur_time ) );
+
+  if ( sim -> convergence -> converged )
+  {
+    util::fprintf( file, "Target Error %.3f%% reached after %d iterations, %d iterations saved\n\n",
+                   sim -> target_error,
+                   sim -> convergence -> converged_iterations.load(),
+                   sim -> convergence -> iterations_saved.load() );
+  }
+
+  util::fprintf( file, "Event Slab Usage:\n" );
+  for ( size_t i = 0; i < sim -> event_mgr.event_size_classes.size(); ++i )
+  {
+    const event_manager_t::event_size_class_t& size_class = sim -> event_mgr.event_size_classes[ i ];
+    if ( size_class.n_chunks == 0 )
+    {
+      continue;
+    }
+
+    util::fprintf( file, "  Size %-6u PeakLive = %-7u Chunks = %u\n",
+        static_cast<unsigned>( size_class.chunk_size ), size_class.peak_live, size_class.n_chunks );
+  }
+  util::fprintf( file, "\n" );
 #ifdef EVENT_QUEUE_DEBUG
   double total_p = 0;
 
@@ -813,6 +866,22 @@ void print_text_scale_factors( FILE* file, player_t* p, player_processed_report_
 
   util::fprintf( file, "\n" );
 
+  if ( p -> sim -> scaling -> common_random_numbers )
+  {
+    // Correlation of the paired ref/delta iterations, and how many independent iterations each one is worth
+    util::fprintf( file, "    Paired  :" );
+    for ( stat_e i = STAT_NONE; i < STAT_MAX; i++ )
+    {
+      if ( p -> scales_with[ i ] )
+      {
+        util::fprintf( file, "  %s=%.3f(%.1fx)", util::stat_type_abbrev( i ),
+                       p -> scaling_correlation[ sm ].get_stat( i ),
+                       p -> scaling_variance_reduction[ sm ].get_stat( i ) );
+      }
+    }
+    util::fprintf( file, "\n" );
+  }
+
 #if LOOTRANK_ENABLED == 1
   std::array<std::string, SCALE_METRIC_MAX> lootrank       = ri.gear_weights_lootrank_link;
   simplify_html( lootrank[ sm ]  );
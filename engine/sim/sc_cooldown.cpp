@@ -342,7 +342,29 @@ expr_t* cooldown_t::create_expression( action_t*, const std::string& name_str )
   else if ( name_str == "duration" )
     return make_mem_fn_expr( name_str, *this, &cooldown_t::duration );
   else if ( name_str == "up" )
-    return make_mem_fn_expr( name_str, *this, &cooldown_t::up );
+  {
+    struct up_expr_t : public expr_t
+    {
+      const cooldown_t* cd;
+      up_expr_t( const cooldown_t* c ) :
+        expr_t( "up" ), cd( c )
+      { }
+
+      virtual double evaluate()
+      { return cd -> up(); }
+
+      // Changes with ready, or once the sim reaches it
+      virtual bool dependencies( expr_deps_t& deps )
+      {
+        expr_slot_t s;
+        s.set( cd -> ready );
+        deps.values.push_back( s );
+        deps.times.push_back( &cd -> ready );
+        return true;
+      }
+    };
+    return new up_expr_t( this );
+  }
   else if ( name_str == "charges" )
     return make_ref_expr( name_str, current_charge );
   else if ( name_str == "charges_fractional" )
@@ -5,13 +5,76 @@
 
 #include "simulationcraft.hpp"
 
+#if defined( SC_VS )
+#include <intrin.h>
+#endif
+
+namespace { // UNNAMED NAMESPACE
+
+// Index of the lowest set bit in a non-zero word.
+inline unsigned lowest_set_bit( uint64_t v )
+{
+  assert( v != 0 );
+#if defined( SC_GCC ) || defined( SC_CLANG )
+  return static_cast<unsigned>( __builtin_ctzll( v ) );
+#elif defined( SC_VS ) && defined( _M_X64 )
+  unsigned long idx;
+  _BitScanForward64( &idx, v );
+  return static_cast<unsigned>( idx );
+#else
+  unsigned idx = 0;
+  while ( ! ( v & 1 ) )
+  {
+    v >>= 1;
+    idx++;
+  }
+  return idx;
+#endif
+}
+
+// Smallest event chunk payload; size classes double from here.
+const std::size_t EVENT_CHUNK_MIN_SIZE = 64;
+
+// Chunk header size, rounded up to keep the event itself 16 byte aligned.
+const std::size_t EVENT_CHUNK_HEADER_SIZE = ( sizeof( event_manager_t::event_chunk_t ) + 15 ) & ~std::size_t( 15 );
+
+// Minimum slab size in bytes, and the minimum number of chunks per slab.
+const std::size_t EVENT_SLAB_SIZE = 16384;
+const std::size_t EVENT_SLAB_MIN_CHUNKS = 8;
+
+inline event_manager_t::event_chunk_t* event_chunk( event_t* e )
+{
+  return reinterpret_cast<event_manager_t::event_chunk_t*>( reinterpret_cast<char*>( e ) - EVENT_CHUNK_HEADER_SIZE );
+}
+
+inline event_t* chunk_event( event_manager_t::event_chunk_t* c )
+{
+  return reinterpret_cast<event_t*>( reinterpret_cast<char*>( c ) + EVENT_CHUNK_HEADER_SIZE );
+}
+
+// Heap ordering of the overflow tier; std::push_heap builds a max-heap, so the
+// comparison is inverted to keep the earliest (and then oldest) event on top.
+struct overflow_event_order_t
+{
+  bool operator()( const event_t* l, const event_t* r ) const
+  {
+    if ( l -> time != r -> time )
+      return l -> time > r -> time;
+
+    return l -> id > r -> id;
+  }
+};
+
+} // UNNAMED NAMESPACE
+
 // ==========================================================================
 // Event
 // ==========================================================================
 
 event_t::event_t( sim_t& s, actor_t* a ) :
-  _sim( s ), next( nullptr ), time( timespan_t::zero() ),
-  reschedule_time( timespan_t::zero() ), id( 0 ), canceled( false ), recycled( false )
+  _sim( s ), next( nullptr ), prev( nullptr ), time( timespan_t::zero() ),
+  reschedule_time( timespan_t::zero() ), id( 0 ), canceled( false ), recycled( false ),
+  in_wheel( false )
 #if ACTOR_EVENT_BOOKKEEPING
   ,actor( a )
 #endif
@@ -22,8 +85,9 @@ event_t::event_t( sim_t& s, actor_t* a ) :
   }
 
 event_t::event_t( actor_t& a ) :
-  _sim( *a.sim ), next( nullptr ), time( timespan_t::zero() ),
-  reschedule_time( timespan_t::zero() ), id( 0 ), canceled( false ), recycled( false )
+  _sim( *a.sim ), next( nullptr ), prev( nullptr ), time( timespan_t::zero() ),
+  reschedule_time( timespan_t::zero() ), id( 0 ), canceled( false ), recycled( false ),
+  in_wheel( false )
 #if ACTOR_EVENT_BOOKKEEPING
   ,actor( &a )
 #endif
@@ -67,6 +131,7 @@ void event_t::cancel( event_t*& e )
 #endif
 
   e -> canceled = true;
+  e -> _sim.event_mgr.cancel_event( e );
   e = nullptr;
 }
 
@@ -85,13 +150,20 @@ event_manager_t::event_manager_t( sim_t* s ) :
   timing_slice( 0 ),
   global_event_id( 0 ),
   timing_wheel(),
-  recycled_event_list( nullptr ),
+  wheel_occupancy(),
+  wheel_occupancy_summary(),
+  event_size_classes(),
+  live_events(),
   wheel_seconds( 0 ),
   wheel_size( 0 ),
   wheel_mask( 0 ),
   wheel_shift( 5 ),
   wheel_granularity( 0.0 ),
   wheel_time( timespan_t::zero() ),
+  wheel_overflow( true ),
+  total_events_canceled( 0 ),
+  total_tombstones_processed( 0 ),
+  total_events_executed( 0 ),
   event_stopwatch( STOPWATCH_THREAD ),
 #ifdef EVENT_QUEUE_DEBUG
   monitor_cpu( false ),
@@ -100,23 +172,27 @@ event_manager_t::event_manager_t( sim_t* s ) :
   n_requested_events( 0 ),
   n_end_insert( 0 ),
   events_traversed( 0 ),
-  events_added( 0 )
+  events_added( 0 ),
+  events_cascaded( 0 ),
+  slices_visited( 0 ),
+  slices_skipped( 0 )
 #else
   monitor_cpu( false )
 #endif /* EVENT_QUEUE_DEBUG */
 {
-  allocated_events.reserve( 100 );
+  live_events.prev = live_events.next = &live_events;
 }
 
 // event_manager_t::~event_manager_t ========================================
 
 event_manager_t::~event_manager_t()
 {
-  while ( recycled_event_list )
+  for ( auto& size_class : event_size_classes )
   {
-    event_t* e = recycled_event_list;
-    recycled_event_list = e -> next;
-    free( e );
+    for ( auto slab : size_class.slabs )
+    {
+      free( slab );
+    }
   }
 }
 
@@ -124,40 +200,69 @@ event_manager_t::~event_manager_t()
 
 void* event_manager_t::allocate_event( const std::size_t size )
 {
-  static const std::size_t SIZE = 2 * sizeof( event_t );
-  assert( SIZE > size ); ( void ) size;
-
-  event_t* e = recycled_event_list;
 #ifdef EVENT_QUEUE_DEBUG
-      n_requested_events++;
-      if ( size >= event_requested_size_count.size() )
-      {
-        event_requested_size_count.resize( size + 1 );
-      }
-      event_requested_size_count[ size ]++;
+  n_requested_events++;
+  if ( size >= event_requested_size_count.size() )
+  {
+    event_requested_size_count.resize( size + 1 );
+  }
+  event_requested_size_count[ size ]++;
 #endif
-  if ( e )
+
+  unsigned class_idx = 0;
+  while ( ( EVENT_CHUNK_MIN_SIZE << class_idx ) < size )
   {
-    recycled_event_list = e -> next;
+    class_idx++;
   }
-  else
+
+  while ( event_size_classes.size() <= class_idx )
   {
-    e = (event_t*) malloc( SIZE );
+    event_size_classes.push_back( event_size_class_t( EVENT_CHUNK_MIN_SIZE << event_size_classes.size() ) );
+  }
 
-    if ( ! e )
+  event_size_class_t& size_class = event_size_classes[ class_idx ];
+
+  // Carve a new slab into chunks when the free list runs dry
+  if ( ! size_class.free_list )
+  {
+    std::size_t stride = EVENT_CHUNK_HEADER_SIZE + size_class.chunk_size;
+    std::size_t n_chunks = std::max( EVENT_SLAB_MIN_CHUNKS, EVENT_SLAB_SIZE / stride );
+    char* slab = static_cast<char*>( malloc( n_chunks * stride ) );
+    if ( ! slab )
     {
       throw std::bad_alloc();
     }
-    else
-    {
+
+    size_class.slabs.push_back( slab );
+    size_class.n_chunks += static_cast<unsigned>( n_chunks );
 #ifdef EVENT_QUEUE_DEBUG
-      n_allocated_events++;
+    n_allocated_events += static_cast<unsigned>( n_chunks );
 #endif
-      allocated_events.push_back( e );
+
+    for ( std::size_t i = n_chunks; i > 0; --i )
+    {
+      event_chunk_t* c = reinterpret_cast<event_chunk_t*>( slab + ( i - 1 ) * stride );
+      c -> size_class = class_idx;
+      c -> next = size_class.free_list;
+      size_class.free_list = c;
     }
   }
 
-  return e;
+  event_chunk_t* c = size_class.free_list;
+  size_class.free_list = c -> next;
+
+  // Link into the live event list
+  c -> prev = &live_events;
+  c -> next = live_events.next;
+  live_events.next -> prev = c;
+  live_events.next = c;
+
+  if ( ++size_class.live > size_class.peak_live )
+  {
+    size_class.peak_live = size_class.live;
+  }
+
+  return chunk_event( c );
 }
 
 // event_manager_t::recycle_event ===========================================
@@ -166,8 +271,15 @@ void event_manager_t::recycle_event( event_t* e )
 {
   e -> ~event_t();
   e -> recycled = true;
-  e -> next = recycled_event_list;
-  recycled_event_list = e;
+
+  event_chunk_t* c = event_chunk( e );
+  c -> prev -> next = c -> next;
+  c -> next -> prev = c -> prev;
+
+  event_size_class_t& size_class = event_size_classes[ c -> size_class ];
+  c -> next = size_class.free_list;
+  size_class.free_list = c;
+  size_class.live--;
 }
 
 // event_manager_t::add_event ===============================================
@@ -180,7 +292,7 @@ void event_manager_t::add_event( event_t* e,
   if ( delta_time < timespan_t::zero() )
     delta_time = timespan_t::zero();
 
-  if ( delta_time > wheel_time )
+  if ( delta_time > wheel_time && ! wheel_overflow )
   {
     e -> time = current_time + wheel_time - timespan_t::from_seconds( 1 );
     e -> reschedule_time = current_time + delta_time;
@@ -191,25 +303,114 @@ void event_manager_t::add_event( event_t* e,
     e -> reschedule_time = timespan_t::zero();
   }
 
+  if ( wheel_overflow && delta_time > wheel_time )
+  {
+    // Beyond the wheel horizon, park the event in the overflow tier until
+    // cascade_overflow() moves it into the wheel.
+    e -> in_wheel = false;
+    overflow_events.push_back( e );
+    std::push_heap( overflow_events.begin(), overflow_events.end(), overflow_event_order_t() );
+  }
+  else
+  {
+    wheel_insert( e );
+  }
+
+  if ( ++events_remaining > max_events_remaining ) max_events_remaining = events_remaining;
+
+  if ( sim -> debug )
+    sim -> out_debug.printf( "Add Event: %s time=%.4f rs-time=%.4f id=%d",
+			     e -> name(), e -> time.total_seconds(),
+			     e -> reschedule_time.total_seconds(),
+			     e -> id );
+
+#if ACTOR_EVENT_BOOKKEEPING
+  if ( sim -> debug && e -> actor )
+  {
+    e -> actor -> event_counter++;
+    sim -> out_debug.printf( "Actor %s has %d scheduled events",
+			     e -> actor -> name(), e -> actor -> event_counter );
+  }
+#endif
+}
+
+// event_manager_t::wheel_insert ============================================
+
+void event_manager_t::wheel_insert( event_t* e )
+{
   // Determine the timing wheel position to which the event will belong
   // Only valid for integer based timespan_t
   uint32_t slice = static_cast<uint32_t>(( e -> time.total_millis() >> wheel_shift ) & wheel_mask);
 
-  // Insert event into the event list at the appropriate time
-  event_t** prev = &( timing_wheel[ slice ] );
+  wheel_slice_t& list = timing_wheel[ slice ];
+
+#ifdef EVENT_QUEUE_DEBUG
+  events_added++;
+#endif
+
+  // Events are ordered by time, then by id, so cascaded overflow events keep
+  // their place relative to later additions. Most events sort behind
+  // everything already in the slice, and are appended through the tail.
+  e -> in_wheel = true;
+
+  if ( ! list.tail )
+  {
+    e -> next = e -> prev = nullptr;
+    list.head = list.tail = e;
+#ifdef EVENT_QUEUE_DEBUG
+    if ( event_queue_depth_samples.empty() )
+    {
+      event_queue_depth_samples.resize( 1 );
+    }
+    event_queue_depth_samples[ 0 ].first++;
+#endif
+  }
+  else if ( list.tail -> time < e -> time ||
+            ( list.tail -> time == e -> time && list.tail -> id < e -> id ) )
+  {
+    e -> next = nullptr;
+    e -> prev = list.tail;
+    list.tail -> next = e;
+    list.tail = e;
+#ifdef EVENT_QUEUE_DEBUG
+    if ( event_queue_depth_samples.empty() )
+    {
+      event_queue_depth_samples.resize( 1 );
+    }
+    event_queue_depth_samples[ 0 ].first++;
+    event_queue_depth_samples[ 0 ].second++;
+    n_end_insert++;
+#endif
+  }
+  else
+  {
+    insert_sorted( list, e );
+  }
+
+  wheel_occupancy[ slice >> 6 ] |= uint64_t( 1 ) << ( slice & 63 );
+  wheel_occupancy_summary[ slice >> 12 ] |= uint64_t( 1 ) << ( ( slice >> 6 ) & 63 );
+}
+
+// event_manager_t::insert_sorted ===========================================
+
+void event_manager_t::insert_sorted( wheel_slice_t& list, event_t* e )
+{
+  // Insert event into the event list at the appropriate time. The event sorts
+  // before the tail, so the list tail never changes here.
+  event_t* pos = list.head;
 #ifdef EVENT_QUEUE_DEBUG
   unsigned traversed = 0;
 #endif
 
-  while ( ( *prev ) && ( *prev ) -> time <= e -> time ) // Find position in the list
+  while ( pos -> time < e -> time ||
+          ( pos -> time == e -> time && pos -> id < e -> id ) )
   {
-    prev = &( ( *prev ) -> next );
+    pos = pos -> next;
 #ifdef EVENT_QUEUE_DEBUG
     traversed++;
 #endif
   }
 #ifdef EVENT_QUEUE_DEBUG
-  events_added++;
   events_traversed += traversed;
   if ( traversed > max_queue_depth )
   {
@@ -220,32 +421,107 @@ void event_manager_t::add_event( event_t* e,
     event_queue_depth_samples.resize( traversed + 1 );
   }
   event_queue_depth_samples[ traversed ].first++;
-  if ( ! *prev && traversed )
+#endif
+  // insert event in front of pos
+  e -> next = pos;
+  e -> prev = pos -> prev;
+  if ( pos -> prev )
+    pos -> prev -> next = e;
+  else
+    list.head = e;
+  pos -> prev = e;
+}
+
+// event_manager_t::wheel_remove ============================================
+
+void event_manager_t::wheel_remove( event_t* e )
+{
+  uint32_t slice = static_cast<uint32_t>(( e -> time.total_millis() >> wheel_shift ) & wheel_mask);
+  wheel_slice_t& list = timing_wheel[ slice ];
+
+  if ( e -> prev )
+    e -> prev -> next = e -> next;
+  else
+    list.head = e -> next;
+
+  if ( e -> next )
+    e -> next -> prev = e -> prev;
+  else
+    list.tail = e -> prev;
+
+  e -> next = e -> prev = nullptr;
+  e -> in_wheel = false;
+
+  if ( ! list.head )
   {
-    event_queue_depth_samples[ traversed ].second++;
-    n_end_insert++;
+    wheel_occupancy[ slice >> 6 ] &= ~( uint64_t( 1 ) << ( slice & 63 ) );
+    if ( ! wheel_occupancy[ slice >> 6 ] )
+      wheel_occupancy_summary[ slice >> 12 ] &= ~( uint64_t( 1 ) << ( ( slice >> 6 ) & 63 ) );
   }
-#endif
-  // insert event
-  e -> next = *prev;
-  *prev = e;
+}
 
-  if ( ++events_remaining > max_events_remaining ) max_events_remaining = events_remaining;
+// event_manager_t::cancel_event ============================================
+
+void event_manager_t::cancel_event( event_t* e )
+{
+  // Events outside the wheel (currently executing, not yet scheduled, or in the
+  // overflow tier) stay flagged as canceled and are discarded when they come up.
+  if ( ! e -> in_wheel )
+    return;
 
   if ( sim -> debug )
-    sim -> out_debug.printf( "Add Event: %s time=%.4f rs-time=%.4f id=%d",
-			     e -> name(), e -> time.total_seconds(),
-			     e -> reschedule_time.total_seconds(),
-			     e -> id );
+    sim -> out_debug.printf( "Cancel Event: %s id=%d", e -> name(), e -> id );
 
-#if ACTOR_EVENT_BOOKKEEPING
-  if ( sim -> debug && e -> actor )
+  wheel_remove( e );
+  events_remaining--;
+  total_events_canceled++;
+  canceled_events.push_back( e );
+}
+
+// event_manager_t::reclaim_canceled_events =================================
+
+void event_manager_t::reclaim_canceled_events()
+{
+  for ( size_t i = 0; i < canceled_events.size(); ++i )
   {
-    e -> actor -> event_counter++;
-    sim -> out_debug.printf( "Actor %s has %d scheduled events",
-			     e -> actor -> name(), e -> actor -> event_counter );
+    event_t* e = canceled_events[ i ];
+    assert( e -> canceled && ! e -> in_wheel && ! e -> recycled );
+    recycle_event( e );
   }
+  canceled_events.clear();
+}
+
+// event_manager_t::cascade_overflow ========================================
+
+void event_manager_t::cascade_overflow()
+{
+  while ( ! overflow_events.empty() &&
+          overflow_events.front() -> time - current_time <= wheel_time )
+  {
+    std::pop_heap( overflow_events.begin(), overflow_events.end(), overflow_event_order_t() );
+    event_t* e = overflow_events.back();
+    overflow_events.pop_back();
+
+    if ( e -> canceled )
+    {
+      if ( sim -> debug )
+        sim -> out_debug.printf( "Canceled event: %s", e -> name() );
+
+      events_remaining--;
+      total_tombstones_processed++;
+      recycle_event( e );
+      continue;
+    }
+
+    if ( sim -> debug )
+      sim -> out_debug.printf( "Cascade Event: %s time=%.4f id=%d",
+                               e -> name(), e -> time.total_seconds(), e -> id );
+
+    wheel_insert( e );
+#ifdef EVENT_QUEUE_DEBUG
+    events_cascaded++;
 #endif
+  }
 }
 
 // event_manager_t::reschedule_event ========================================
@@ -263,6 +539,9 @@ bool event_manager_t::execute()
 {
   while ( event_t* e = next_event() )
   {
+    if ( ! canceled_events.empty() && e -> time > current_time )
+      reclaim_canceled_events();
+
     current_time = e -> time;
 
 #if ACTOR_EVENT_BOOKKEEPING
@@ -282,6 +561,8 @@ bool event_manager_t::execute()
     {
       if ( sim -> debug )
         sim -> out_debug.printf( "Canceled event: %s", e -> name() );
+
+      total_tombstones_processed++;
     }
     else if ( e -> reschedule_time > e -> time )
     {
@@ -293,6 +574,8 @@ bool event_manager_t::execute()
       if ( sim -> debug )
         sim -> out_debug.printf( "Executing event: %s", e -> name() );
 
+      total_events_executed++;
+
       if ( monitor_cpu )
       {
 #if ACTOR_EVENT_BOOKKEEPING
@@ -333,17 +616,25 @@ void event_manager_t::cancel()
 
 void event_manager_t::flush()
 {
-  for(auto e : allocated_events)
+  // Only events that are still alive need to be canceled and recycled; the
+  // rest of the iteration's events already sit on the slab free lists.
+  while ( live_events.next != &live_events )
   {
-    
-    if( e -> recycled ) continue;
+    event_t* e = chunk_event( live_events.next );
     event_t* null_e = e; // necessary evil
+    e -> in_wheel = false; // The wheel is cleared wholesale below
     event_t::cancel( null_e );
     recycle_event( e );
   }
 
+  // Canceled events still waiting to be reclaimed were recycled above
+  canceled_events.clear();
+
   // Clear Timing Wheel
-  timing_wheel.assign( timing_wheel.size(), nullptr );
+  timing_wheel.assign( timing_wheel.size(), wheel_slice_t() );
+  wheel_occupancy.assign( wheel_occupancy.size(), 0 );
+  wheel_occupancy_summary.assign( wheel_occupancy_summary.size(), 0 );
+  overflow_events.clear();
 }
 
 // event_manager_t::init ====================================================
@@ -352,7 +643,11 @@ void event_manager_t::init()
 {
   // Timing wheel depth defaults to about 17 minutes with a granularity of 32 buckets per second.
   // This makes wheel_size = 32K and it's fully used.
-  if ( wheel_seconds     < 1024 ) wheel_seconds     = 1024; // 2^10 Min to ensure limited wrap-around
+  // With the overflow tier enabled, far-future events do not bounce around the wheel, so shorter
+  // wheels may be configured.
+  if ( wheel_seconds     <=   0 ) wheel_seconds     = 1024; // 2^10
+  if ( ! wheel_overflow && wheel_seconds < 1024 ) wheel_seconds = 1024; // Min to ensure limited wrap-around
+  if ( wheel_seconds     <  64 ) wheel_seconds     = 64;
   if ( wheel_granularity <=   0 ) wheel_granularity = 32;   // 2^5 Time slices per second
 
   wheel_time = timespan_t::from_seconds( wheel_seconds );
@@ -367,6 +662,39 @@ void event_manager_t::init()
 
   // The timing wheel represents an array of event lists: Each time slice has an event list.
   timing_wheel.resize( wheel_size );
+  wheel_occupancy.resize( ( wheel_size + 63 ) / 64 );
+  wheel_occupancy_summary.resize( ( wheel_occupancy.size() + 63 ) / 64 );
+}
+
+// event_manager_t::next_occupied_slice =====================================
+
+unsigned event_manager_t::next_occupied_slice( unsigned from ) const
+{
+  // Remaining slices of the word 'from' lives in
+  size_t word = from >> 6;
+  uint64_t bits = wheel_occupancy[ word ] & ( ~uint64_t( 0 ) << ( from & 63 ) );
+  if ( bits )
+    return static_cast<unsigned>( ( word << 6 ) + lowest_set_bit( bits ) );
+
+  // Find the next non-empty word through the summary, turning the wheel around
+  // at the end. The wheel holds at least one event, so this terminates; at the
+  // latest it comes back to the lower slices of the starting word.
+  word++;
+  while ( true )
+  {
+    if ( word >= wheel_occupancy.size() )
+      word = 0;
+
+    size_t summary_word = word >> 6;
+    uint64_t summary_bits = wheel_occupancy_summary[ summary_word ] & ( ~uint64_t( 0 ) << ( word & 63 ) );
+    if ( summary_bits )
+    {
+      word = ( summary_word << 6 ) + lowest_set_bit( summary_bits );
+      return static_cast<unsigned>( ( word << 6 ) + lowest_set_bit( wheel_occupancy[ word ] ) );
+    }
+
+    word = ( summary_word + 1 ) << 6;
+  }
 }
 
 // event_manager_t::next_event ==============================================
@@ -376,27 +704,45 @@ event_t* event_manager_t::next_event()
   if ( events_remaining == 0 )
     return nullptr;
 
-  while ( true )
+  if ( ! overflow_events.empty() )
   {
-    event_t*& event_list = timing_wheel[ timing_slice ];
-    if ( event_list )
+    cascade_overflow();
+
+    // Canceled overflow events are discarded while cascading
+    if ( events_remaining == 0 )
+      return nullptr;
+
+    // Nothing left in the wheel, so the earliest overflow event is next. Jump
+    // the wheel straight to it instead of turning through empty slices.
+    if ( events_remaining == overflow_events.size() )
     {
-      event_t* e = event_list;
-      event_list = e -> next;
+      std::pop_heap( overflow_events.begin(), overflow_events.end(), overflow_event_order_t() );
+      event_t* e = overflow_events.back();
+      overflow_events.pop_back();
+      timing_slice = static_cast<unsigned>( ( e -> time.total_millis() >> wheel_shift ) & wheel_mask );
       events_remaining--;
       events_processed++;
       return e;
     }
+  }
 
-    timing_slice++;
-    if ( timing_slice == timing_wheel.size() )
-    {
-      timing_slice = 0;
-      // Time Wheel turns around.
-    }
+  // Jump straight to the next populated slice, turning the wheel around if
+  // necessary.
+  if ( ! timing_wheel[ timing_slice ].head )
+  {
+    unsigned slice = next_occupied_slice( timing_slice );
+#ifdef EVENT_QUEUE_DEBUG
+    slices_visited++;
+    slices_skipped += ( slice - timing_slice - 1 ) & wheel_mask;
+#endif
+    timing_slice = slice;
   }
 
-  return nullptr;
+  event_t* e = timing_wheel[ timing_slice ].head;
+  wheel_remove( e );
+  events_remaining--;
+  events_processed++;
+  return e;
 }
 
 // event_manager_t::reset ===================================================
@@ -417,9 +763,27 @@ void event_manager_t::merge( event_manager_t& other )
 {
   max_events_remaining = std::max( max_events_remaining, other.max_events_remaining );
   total_events_processed += other.total_events_processed;
+  total_events_canceled += other.total_events_canceled;
+  total_tombstones_processed += other.total_tombstones_processed;
+  total_events_executed += other.total_events_executed;
+
+  // Slab statistics only; the memory itself stays with its owner
+  for ( size_t i = 0; i < other.event_size_classes.size(); ++i )
+  {
+    if ( i >= event_size_classes.size() )
+    {
+      event_size_classes.push_back( event_size_class_t( other.event_size_classes[ i ].chunk_size ) );
+    }
+
+    event_size_classes[ i ].peak_live = std::max( event_size_classes[ i ].peak_live, other.event_size_classes[ i ].peak_live );
+    event_size_classes[ i ].n_chunks += other.event_size_classes[ i ].n_chunks;
+  }
 #ifdef EVENT_QUEUE_DEBUG
   events_traversed += other.events_traversed;
   events_added += other.events_added;
+  events_cascaded += other.events_cascaded;
+  slices_visited += other.slices_visited;
+  slices_skipped += other.slices_skipped;
   n_allocated_events += other.n_allocated_events;
   n_end_insert += other.n_end_insert;
   n_requested_events += other.n_requested_events;
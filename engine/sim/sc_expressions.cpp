@@ -24,21 +24,35 @@ public:
 
   bool is_constant( double* v ) // override
   { *v = value; return true; }
+
+  bool dependencies( expr_deps_t& ) // override
+  { return true; }
 };
 
 // Unary Operators ==========================================================
 
-template <double ( *F )( double )>
-class expr_unary_t : public expr_t
+class unary_base_t : public expr_t
 {
+public:
   expr_t* input;
 
-public:
-  expr_unary_t( const std::string& n, token_e o, expr_t* i ) :
+  unary_base_t( const std::string& n, token_e o, expr_t* i ) :
     expr_t( n, o ), input( i )
   { assert( input ); }
 
-  ~expr_unary_t() { delete input; }
+  ~unary_base_t() { delete input; }
+
+  bool dependencies( expr_deps_t& deps ) // override
+  { return input -> dependencies( deps ); }
+};
+
+template <double ( *F )( double )>
+class expr_unary_t : public unary_base_t
+{
+public:
+  expr_unary_t( const std::string& n, token_e o, expr_t* i ) :
+    unary_base_t( n, o, i )
+  {}
 
   double evaluate() // override
   { return F( input -> eval() ); }
@@ -83,6 +97,9 @@ public:
   }
 
   ~binary_base_t() { delete left; delete right; }
+
+  bool dependencies( expr_deps_t& deps ) // override
+  { return left -> dependencies( deps ) && right -> dependencies( deps ); }
 };
 
 class logical_and_t : public binary_base_t
@@ -154,6 +171,40 @@ expr_t* select_binary( const std::string& name, token_e op, expr_t* left, expr_t
   }
 }
 
+// Binary operators with one side reduced to a constant by
+// expr_analyze_binary_t::optimize
+class left_reduced_base_t : public expr_t
+{
+public:
+  double left;
+  expr_t* right;
+
+  left_reduced_base_t( const std::string& n, token_e o, double l, expr_t* r ) :
+    expr_t( n, o ), left( l ), right( r )
+  {}
+
+  ~left_reduced_base_t() { delete right; }
+
+  bool dependencies( expr_deps_t& deps ) // override
+  { return right -> dependencies( deps ); }
+};
+
+class right_reduced_base_t : public expr_t
+{
+public:
+  expr_t* left;
+  double right;
+
+  right_reduced_base_t( const std::string& n, token_e o, expr_t* l, double r ) :
+    expr_t( n, o ), left( l ), right( r )
+  {}
+
+  ~right_reduced_base_t() { delete left; }
+
+  bool dependencies( expr_deps_t& deps ) // override
+  { return left -> dependencies( deps ); }
+};
+
 // Analyzing Unary Operators ================================================
 
 template <double ( *F )( double )>
@@ -530,11 +581,9 @@ public:
     if( left_constant )
     {
       if( EXPRESSION_DEBUG ) printf( "%*d %s binary expression reduced left\n", spacing, id_, name().c_str() );
-      struct left_reduced_t : public expr_t
+      struct left_reduced_t : public left_reduced_base_t
       {
-  double left;
-  expr_t* right;
-  left_reduced_t( const std::string& n, token_e o, double l, expr_t* r ) : expr_t( n, o ), left(l), right(r) {}
+  left_reduced_t( const std::string& n, token_e o, double l, expr_t* r ) : left_reduced_base_t( n, o, l, r ) {}
   double evaluate() { return F<double>()( left, right -> eval() ); }
       };
       expr_t* reduced = new left_reduced_t( name(), op_, left_value, right );
@@ -545,11 +594,9 @@ public:
     if( right_constant )
     {
       if( EXPRESSION_DEBUG ) printf( "%*d %s binary expression reduced right\n", spacing, id_, name().c_str() );
-      struct right_reduced_t : public expr_t
+      struct right_reduced_t : public right_reduced_base_t
       {
-  expr_t* left;
-  double right;
-  right_reduced_t( const std::string& n, token_e o, expr_t* l, double r ) : expr_t( n, o ), left(l), right(r) {}
+  right_reduced_t( const std::string& n, token_e o, expr_t* l, double r ) : right_reduced_base_t( n, o, l, r ) {}
   double evaluate() { return F<double>()( left -> eval(), right ); }
       };
       expr_t* reduced = new right_reduced_t( name(), op_, left, right_value );
@@ -587,236 +634,1167 @@ expr_t* select_analyze_binary( const std::string& name, token_e op, expr_t* left
   }
 }
 
-} // UNNAMED NAMESPACE ====================================================
+// Compiled Expressions =====================================================
 
-// precedence ===============================================================
+#if defined( SC_GCC ) || defined( SC_CLANG )
+// Threaded dispatch, one indirect jump per instruction instead of a shared one
+#  define EXPR_COMPUTED_GOTO
+#endif
 
-int expression_t::precedence( token_e expr_token_type )
+/* Register based bytecode for a whole expression tree. Operators become
+ * instructions on a small register file instead of a virtual call per node,
+ * && and || short-circuit with jumps, constants are immediates, and
+ * expressions that only read memory ( expr_t::slot ) are loaded directly.
+ * Any other expression is called, and evaluates exactly as before.
+ */
+class expr_program_t
 {
-  switch ( expr_token_type )
-  {
-    case TOK_FLOOR:
-    case TOK_CEIL:
-      return 8;
-
-    case TOK_NOT:
-    case TOK_PLUS:
-    case TOK_MINUS:
-    case TOK_ABS:
-      return 7;
-
-    case TOK_MULT:
-    case TOK_DIV:
-      return 6;
-
-    case TOK_ADD:
-    case TOK_SUB:
-      return 5;
-
-    case TOK_EQ:
-    case TOK_NOTEQ:
-    case TOK_LT:
-    case TOK_LTEQ:
-    case TOK_GT:
-    case TOK_GTEQ:
-    case TOK_IN:
-    case TOK_NOTIN:
-      return 4;
-
-    case TOK_AND:
-      return 3;
-
-    case TOK_XOR:
-      return 2;
-
-    case TOK_OR:
-      return 1;
-
-    default:
-      assert( false );
-      return 0;
-  }
-}
-
-// is_unary =================================================================
+public:
+  static const unsigned MAX_REGISTERS = 32;
 
-bool expression_t::is_unary( token_e expr_token_type )
-{
-  switch ( expr_token_type )
+  enum opcode_e
   {
-    case TOK_NOT:
-    case TOK_PLUS:
-    case TOK_MINUS:
-    case TOK_ABS:
-    case TOK_FLOOR:
-    case TOK_CEIL:
-      return true;
-    default:
-      return false;
-  }
-}
+    OP_CONST, OP_LOAD_DOUBLE, OP_LOAD_INT, OP_LOAD_UNSIGNED, OP_LOAD_BOOL, OP_LOAD_TIMESPAN, OP_CALL,
+    OP_NEG, OP_NOT, OP_ABS, OP_FLOOR, OP_CEIL, OP_TRUTH,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_EQ, OP_NOTEQ, OP_LT, OP_LTEQ, OP_GT, OP_GTEQ, OP_XOR,
+    // right operand is the immediate value
+    OP_ADD_K, OP_SUB_K, OP_MUL_K, OP_DIV_K, OP_EQ_K, OP_NOTEQ_K, OP_LT_K, OP_LTEQ_K, OP_GT_K, OP_GTEQ_K,
+    // load and compare against the immediate value in one go, the usual
+    // resource.x>=y or buff.x.stack<y
+    OP_DOUBLE_EQ_K, OP_DOUBLE_NOTEQ_K, OP_DOUBLE_LT_K, OP_DOUBLE_LTEQ_K, OP_DOUBLE_GT_K, OP_DOUBLE_GTEQ_K,
+    OP_INT_EQ_K, OP_INT_NOTEQ_K, OP_INT_LT_K, OP_INT_LTEQ_K, OP_INT_GT_K, OP_INT_GTEQ_K,
+    OP_JUMP_FALSE, OP_JUMP_TRUE, OP_RETURN
+  };
+
+  struct instr_t
+  {
+    uint8_t op, dst, a, b;
+    uint32_t jump;
+    union
+    {
+      double value;
+      const void* address;
+      expr_t* expr;
+    };
+    const void* address2; // slot of fused load and compare
+  };
 
-// is_binary ================================================================
+  std::vector<instr_t> code;
 
-bool expression_t::is_binary( token_e expr_token_type )
-{
-  switch ( expr_token_type )
+  bool build( expr_t* root )
   {
-    case TOK_MULT:
-    case TOK_DIV:
-    case TOK_ADD:
-    case TOK_SUB:
-    case TOK_EQ:
-    case TOK_NOTEQ:
-    case TOK_LT:
-    case TOK_LTEQ:
-    case TOK_GT:
-    case TOK_GTEQ:
-    case TOK_AND:
-    case TOK_XOR:
-    case TOK_OR:
-    case TOK_IN:
-    case TOK_NOTIN:
-      return true;
-    default:
+    code.clear();
+    bool boolean;
+    if ( ! emit( root, 0, boolean ) )
       return false;
+    add( OP_RETURN, 0, 0 );
+    return true;
   }
-}
-
-// next_token ===============================================================
-
-token_e expression_t::next_token( action_t* action, const std::string& expr_str,
-                                  int& current_index, std::string& token_str, token_e prev_token )
-{
-  unsigned char c = expr_str[ current_index++ ];
 
-  if ( c == '\0' ) return TOK_UNKNOWN;
-  if ( ( prev_token == TOK_FLOOR || prev_token == TOK_CEIL ) && c != '(' )
-    return TOK_UNKNOWN;
-
-  token_str = c;
-
-  if ( c == '@' ) return TOK_ABS;
-  if ( c == '+' ) return TOK_ADD;
-  if ( c == '-' && ( prev_token == TOK_STR || prev_token == TOK_NUM ) ) return TOK_SUB;
-  if ( c == '-' && prev_token != TOK_STR && prev_token != TOK_NUM && ! isdigit( static_cast<unsigned char>( expr_str[ current_index ] ) ) ) return TOK_SUB;
-  if ( c == '*' ) return TOK_MULT;
-  if ( c == '%' ) return TOK_DIV;
-  if ( c == '&' )
-  {
-    if ( expr_str[ current_index ] == '&' ) current_index++;
-    return TOK_AND;
-  }
-  if ( c == '|' )
-  {
-    if ( expr_str[ current_index ] == '|' ) current_index++;
-    return TOK_OR;
-  }
-  if ( c == '^' )
-  {
-    if ( expr_str[ current_index ] == '^' ) current_index++;
-    return TOK_XOR;
-  }
-  if ( c == '~' )
-  {
-    if ( expr_str[ current_index ] == '~' ) current_index++;
-    return TOK_IN;
-  }
-  if ( c == '!' )
-  {
-    if ( expr_str[ current_index ] == '=' ) { current_index++; token_str += "="; return TOK_NOTEQ; }
-    if ( expr_str[ current_index ] == '~' ) { current_index++; token_str += "~"; return TOK_NOTIN; }
-    return TOK_NOT;
-  }
-  if ( c == '=' )
-  {
-    if ( expr_str[ current_index ] == '=' ) current_index++;
-    return TOK_EQ;
-  }
-  if ( c == '<' )
+  double run() const
   {
-    if ( expr_str[ current_index ] == '=' ) { current_index++; token_str += "="; return TOK_LTEQ; }
-    return TOK_LT;
+    double r[ MAX_REGISTERS ];
+    const instr_t* pc = code.data();
+
+#if defined( EXPR_COMPUTED_GOTO )
+    static const void* const labels[] =
+    {
+      &&L_OP_CONST, &&L_OP_LOAD_DOUBLE, &&L_OP_LOAD_INT, &&L_OP_LOAD_UNSIGNED, &&L_OP_LOAD_BOOL, &&L_OP_LOAD_TIMESPAN, &&L_OP_CALL,
+      &&L_OP_NEG, &&L_OP_NOT, &&L_OP_ABS, &&L_OP_FLOOR, &&L_OP_CEIL, &&L_OP_TRUTH,
+      &&L_OP_ADD, &&L_OP_SUB, &&L_OP_MUL, &&L_OP_DIV, &&L_OP_EQ, &&L_OP_NOTEQ, &&L_OP_LT, &&L_OP_LTEQ, &&L_OP_GT, &&L_OP_GTEQ, &&L_OP_XOR,
+      &&L_OP_ADD_K, &&L_OP_SUB_K, &&L_OP_MUL_K, &&L_OP_DIV_K, &&L_OP_EQ_K, &&L_OP_NOTEQ_K, &&L_OP_LT_K, &&L_OP_LTEQ_K, &&L_OP_GT_K, &&L_OP_GTEQ_K,
+      &&L_OP_DOUBLE_EQ_K, &&L_OP_DOUBLE_NOTEQ_K, &&L_OP_DOUBLE_LT_K, &&L_OP_DOUBLE_LTEQ_K, &&L_OP_DOUBLE_GT_K, &&L_OP_DOUBLE_GTEQ_K,
+      &&L_OP_INT_EQ_K, &&L_OP_INT_NOTEQ_K, &&L_OP_INT_LT_K, &&L_OP_INT_LTEQ_K, &&L_OP_INT_GT_K, &&L_OP_INT_GTEQ_K,
+      &&L_OP_JUMP_FALSE, &&L_OP_JUMP_TRUE, &&L_OP_RETURN
+    };
+#  define OP_CASE( o ) L_##o
+#  define OP_DISPATCH goto *labels[ pc -> op ]
+#  define OP_NEXT ++pc; OP_DISPATCH
+    OP_DISPATCH;
+    {
+#else
+#  define OP_CASE( o ) case o
+#  define OP_DISPATCH continue
+#  define OP_NEXT ++pc; continue
+    for ( ;; ) switch ( pc -> op )
+    {
+#endif
+      OP_CASE( OP_CONST ):         r[ pc -> dst ] = pc -> value; OP_NEXT;
+      OP_CASE( OP_LOAD_DOUBLE ):   r[ pc -> dst ] = *static_cast<const double*>( pc -> address ); OP_NEXT;
+      OP_CASE( OP_LOAD_INT ):      r[ pc -> dst ] = *static_cast<const int*>( pc -> address ); OP_NEXT;
+      OP_CASE( OP_LOAD_UNSIGNED ): r[ pc -> dst ] = *static_cast<const unsigned*>( pc -> address ); OP_NEXT;
+      OP_CASE( OP_LOAD_BOOL ):     r[ pc -> dst ] = *static_cast<const bool*>( pc -> address ); OP_NEXT;
+      OP_CASE( OP_LOAD_TIMESPAN ): r[ pc -> dst ] = static_cast<const timespan_t*>( pc -> address ) -> total_seconds(); OP_NEXT;
+      OP_CASE( OP_CALL ):          r[ pc -> dst ] = pc -> expr -> eval(); OP_NEXT;
+
+      OP_CASE( OP_NEG ):   r[ pc -> dst ] = unary::minus( r[ pc -> a ] ); OP_NEXT;
+      OP_CASE( OP_NOT ):   r[ pc -> dst ] = unary::lnot ( r[ pc -> a ] ); OP_NEXT;
+      OP_CASE( OP_ABS ):   r[ pc -> dst ] = unary::abs  ( r[ pc -> a ] ); OP_NEXT;
+      OP_CASE( OP_FLOOR ): r[ pc -> dst ] = unary::floor( r[ pc -> a ] ); OP_NEXT;
+      OP_CASE( OP_CEIL ):  r[ pc -> dst ] = unary::ceil ( r[ pc -> a ] ); OP_NEXT;
+      OP_CASE( OP_TRUTH ): r[ pc -> dst ] = r[ pc -> a ] != 0 ? 1.0 : 0.0; OP_NEXT;
+
+      OP_CASE( OP_ADD ):   r[ pc -> dst ] = r[ pc -> a ] +  r[ pc -> b ]; OP_NEXT;
+      OP_CASE( OP_SUB ):   r[ pc -> dst ] = r[ pc -> a ] -  r[ pc -> b ]; OP_NEXT;
+      OP_CASE( OP_MUL ):   r[ pc -> dst ] = r[ pc -> a ] *  r[ pc -> b ]; OP_NEXT;
+      OP_CASE( OP_DIV ):   r[ pc -> dst ] = r[ pc -> a ] /  r[ pc -> b ]; OP_NEXT;
+      OP_CASE( OP_EQ ):    r[ pc -> dst ] = r[ pc -> a ] == r[ pc -> b ]; OP_NEXT;
+      OP_CASE( OP_NOTEQ ): r[ pc -> dst ] = r[ pc -> a ] != r[ pc -> b ]; OP_NEXT;
+      OP_CASE( OP_LT ):    r[ pc -> dst ] = r[ pc -> a ] <  r[ pc -> b ]; OP_NEXT;
+      OP_CASE( OP_LTEQ ):  r[ pc -> dst ] = r[ pc -> a ] <= r[ pc -> b ]; OP_NEXT;
+      OP_CASE( OP_GT ):    r[ pc -> dst ] = r[ pc -> a ] >  r[ pc -> b ]; OP_NEXT;
+      OP_CASE( OP_GTEQ ):  r[ pc -> dst ] = r[ pc -> a ] >= r[ pc -> b ]; OP_NEXT;
+      OP_CASE( OP_XOR ):   r[ pc -> dst ] = bool( r[ pc -> a ] != 0 ) != bool( r[ pc -> b ] != 0 ); OP_NEXT;
+
+      OP_CASE( OP_ADD_K ):   r[ pc -> dst ] = r[ pc -> a ] +  pc -> value; OP_NEXT;
+      OP_CASE( OP_SUB_K ):   r[ pc -> dst ] = r[ pc -> a ] -  pc -> value; OP_NEXT;
+      OP_CASE( OP_MUL_K ):   r[ pc -> dst ] = r[ pc -> a ] *  pc -> value; OP_NEXT;
+      OP_CASE( OP_DIV_K ):   r[ pc -> dst ] = r[ pc -> a ] /  pc -> value; OP_NEXT;
+      OP_CASE( OP_EQ_K ):    r[ pc -> dst ] = r[ pc -> a ] == pc -> value; OP_NEXT;
+      OP_CASE( OP_NOTEQ_K ): r[ pc -> dst ] = r[ pc -> a ] != pc -> value; OP_NEXT;
+      OP_CASE( OP_LT_K ):    r[ pc -> dst ] = r[ pc -> a ] <  pc -> value; OP_NEXT;
+      OP_CASE( OP_LTEQ_K ):  r[ pc -> dst ] = r[ pc -> a ] <= pc -> value; OP_NEXT;
+      OP_CASE( OP_GT_K ):    r[ pc -> dst ] = r[ pc -> a ] >  pc -> value; OP_NEXT;
+      OP_CASE( OP_GTEQ_K ):  r[ pc -> dst ] = r[ pc -> a ] >= pc -> value; OP_NEXT;
+
+#define SLOT( T ) ( static_cast<double>( *static_cast<const T*>( pc -> address2 ) ) )
+      OP_CASE( OP_DOUBLE_EQ_K ):    r[ pc -> dst ] = SLOT( double ) == pc -> value; OP_NEXT;
+      OP_CASE( OP_DOUBLE_NOTEQ_K ): r[ pc -> dst ] = SLOT( double ) != pc -> value; OP_NEXT;
+      OP_CASE( OP_DOUBLE_LT_K ):    r[ pc -> dst ] = SLOT( double ) <  pc -> value; OP_NEXT;
+      OP_CASE( OP_DOUBLE_LTEQ_K ):  r[ pc -> dst ] = SLOT( double ) <= pc -> value; OP_NEXT;
+      OP_CASE( OP_DOUBLE_GT_K ):    r[ pc -> dst ] = SLOT( double ) >  pc -> value; OP_NEXT;
+      OP_CASE( OP_DOUBLE_GTEQ_K ):  r[ pc -> dst ] = SLOT( double ) >= pc -> value; OP_NEXT;
+      OP_CASE( OP_INT_EQ_K ):       r[ pc -> dst ] = SLOT( int ) == pc -> value; OP_NEXT;
+      OP_CASE( OP_INT_NOTEQ_K ):    r[ pc -> dst ] = SLOT( int ) != pc -> value; OP_NEXT;
+      OP_CASE( OP_INT_LT_K ):       r[ pc -> dst ] = SLOT( int ) <  pc -> value; OP_NEXT;
+      OP_CASE( OP_INT_LTEQ_K ):     r[ pc -> dst ] = SLOT( int ) <= pc -> value; OP_NEXT;
+      OP_CASE( OP_INT_GT_K ):       r[ pc -> dst ] = SLOT( int ) >  pc -> value; OP_NEXT;
+      OP_CASE( OP_INT_GTEQ_K ):     r[ pc -> dst ] = SLOT( int ) >= pc -> value; OP_NEXT;
+#undef SLOT
+
+      // Short-circuit, the register already holds the result of the && or ||
+      OP_CASE( OP_JUMP_FALSE ):
+        if ( r[ pc -> a ] != 0 ) { OP_NEXT; }
+        r[ pc -> a ] = 0.0;
+        pc = code.data() + pc -> jump;
+        OP_DISPATCH;
+      OP_CASE( OP_JUMP_TRUE ):
+        if ( r[ pc -> a ] == 0 ) { OP_NEXT; }
+        r[ pc -> a ] = 1.0;
+        pc = code.data() + pc -> jump;
+        OP_DISPATCH;
+
+      OP_CASE( OP_RETURN ): return r[ pc -> a ];
+#if ! defined( EXPR_COMPUTED_GOTO )
+      default: assert( false ); return 0;
+#endif
+    }
+#undef OP_CASE
+#undef OP_DISPATCH
+#undef OP_NEXT
   }
-  if ( c == '>' )
+
+private:
+  instr_t& add( opcode_e op, unsigned dst, unsigned a = 0, unsigned b = 0 )
   {
-    if ( expr_str[ current_index ] == '=' ) { current_index++; token_str += "="; return TOK_GTEQ; }
-    return TOK_GT;
+    instr_t i;
+    i.op = static_cast<uint8_t>( op );
+    i.dst = static_cast<uint8_t>( dst );
+    i.a = static_cast<uint8_t>( a );
+    i.b = static_cast<uint8_t>( b );
+    i.jump = 0;
+    i.value = 0;
+    i.address2 = nullptr;
+    code.push_back( i );
+    return code.back();
   }
-  if ( c == '(' ) return TOK_LPAR;
-  if ( c == ')' ) return TOK_RPAR;
 
-  if ( isalpha( c ) )
+  // Offset of a binary operator within its opcode group, -1 if not supported
+  static int binary_index( token_e t )
   {
-    c = expr_str[ current_index ];
-    while ( isalpha( c ) || isdigit( c ) || c == '_' || c == '.' )
+    switch ( t )
     {
-      token_str += c;
-      c = expr_str[ ++current_index ];
+      case TOK_ADD:   return 0;
+      case TOK_SUB:   return 1;
+      case TOK_MULT:  return 2;
+      case TOK_DIV:   return 3;
+      case TOK_EQ:    return 4;
+      case TOK_NOTEQ: return 5;
+      case TOK_LT:    return 6;
+      case TOK_LTEQ:  return 7;
+      case TOK_GT:    return 8;
+      case TOK_GTEQ:  return 9;
+      default:        return -1;
     }
-
-    if ( util::str_compare_ci( token_str, "floor" ) )
-      return TOK_FLOOR;
-    else if ( util::str_compare_ci( token_str, "ceil" ) )
-      return TOK_CEIL;
-    else
-      return TOK_STR;
   }
 
-  if ( isdigit( c ) || c == '-' )
+  static bool is_comparison( token_e t )
+  { return binary_index( t ) >= 4; }
+
+  static opcode_e unary_op( token_e t )
   {
-    c = expr_str[ current_index ];
-    while ( isdigit( c ) || c == '.' )
+    switch ( t )
     {
-      token_str += c;
-      c = expr_str[ ++current_index ];
+      case TOK_MINUS: return OP_NEG;
+      case TOK_NOT:   return OP_NOT;
+      case TOK_ABS:   return OP_ABS;
+      case TOK_FLOOR: return OP_FLOOR;
+      case TOK_CEIL:  return OP_CEIL;
+      default:        return OP_RETURN;
     }
-
-    return TOK_NUM;
   }
 
-  if ( action )
+  // Slot compared against an immediate value in one instruction, when the
+  // slot is a plain double or int
+  bool emit_slot_compare( const expr_slot_t& slot, token_e op, double value, unsigned r )
   {
-    action -> sim -> errorf( "%s-%s: Unexpected token (%c) in %s\n", action -> player -> name(), action -> name(), c, expr_str.c_str() );
+    if ( ! is_comparison( op ) || slot.compare != TOK_UNKNOWN ||
+         ( slot.type != expr_slot_t::SLOT_DOUBLE && slot.type != expr_slot_t::SLOT_INT ) )
+      return false;
+
+    opcode_e base = slot.type == expr_slot_t::SLOT_DOUBLE ? OP_DOUBLE_EQ_K : OP_INT_EQ_K;
+    instr_t& i = add( static_cast<opcode_e>( base + binary_index( op ) - 4 ), r );
+    i.address2 = slot.address;
+    i.value = value;
+    return true;
   }
-  else
+
+  void emit_load( const expr_slot_t& slot, unsigned r )
   {
-    printf( "Unexpected token (%c) in %s\n", c, expr_str.c_str() );
+    static const opcode_e load[] = { OP_LOAD_DOUBLE, OP_LOAD_INT, OP_LOAD_UNSIGNED, OP_LOAD_BOOL, OP_LOAD_TIMESPAN };
+    add( load[ slot.type ], r ).address = slot.address;
   }
 
-  return TOK_UNKNOWN;
-}
-
-// parse_tokens =============================================================
+  // Operand 'e' compared against ( or combined with ) an immediate value
+  bool emit_binary_k( expr_t* e, token_e op, double value, unsigned r, bool& boolean )
+  {
+    int index = binary_index( op );
+    if ( index < 0 )
+      return false;
 
-std::vector<expr_token_t>
-expression_t::parse_tokens( action_t* action,
-                            const std::string& expr_str )
-{
-  std::vector<expr_token_t> tokens;
+    boolean = is_comparison( op );
 
-  expr_token_t token;
-  int current_index = 0;
-  token_e t = TOK_UNKNOWN;
+    expr_slot_t slot;
+    if ( e -> slot( slot ) && emit_slot_compare( slot, op, value, r ) )
+      return true;
 
-  while ( ( token.type = next_token( action, expr_str, current_index, token.label, t ) ) != TOK_UNKNOWN )
-  {
-    t = token.type;
-    tokens.push_back( token );
+    bool input_boolean;
+    if ( ! emit( e, r, input_boolean ) )
+      return false;
+    add( static_cast<opcode_e>( OP_ADD_K + index ), r, r ).value = value;
+    return true;
   }
 
-  return tokens;
-}
+  // Code evaluating e into register r, registers above r are scratch.
+  // 'boolean' tells if the result is always 0 or 1.
+  bool emit( expr_t* e, unsigned r, bool& boolean )
+  {
+    if ( r + 1 >= MAX_REGISTERS )
+      return false;
 
-// print_tokens =============================================================
+    boolean = false;
 
-void expression_t::print_tokens( std::vector<expr_token_t>& tokens, sim_t* sim )
-{
-  std::string str;
-  if ( tokens.size() > 0 )
-    str += "tokens: ";
+    double value;
+    if ( e -> is_constant( &value ) )
+    {
+      add( OP_CONST, r ).value = value;
+      boolean = value == 0 || value == 1;
+      return true;
+    }
 
-  for ( size_t i = 0; i < tokens.size(); i++ )
+    expr_slot_t slot;
+    if ( e -> slot( slot ) )
+    {
+      if ( slot.compare != TOK_UNKNOWN )
+      {
+        int index = binary_index( slot.compare );
+        expr_slot_t plain = slot;
+        plain.compare = TOK_UNKNOWN;
+        boolean = is_comparison( slot.compare );
+        if ( index < 0 || emit_slot_compare( plain, slot.compare, slot.operand, r ) )
+          return index >= 0;
+        emit_load( plain, r );
+        add( static_cast<opcode_e>( OP_ADD_K + index ), r, r ).value = slot.operand;
+        return true;
+      }
+
+      emit_load( slot, r );
+      boolean = slot.type == expr_slot_t::SLOT_BOOL;
+      return true;
+    }
+
+    if ( unary_base_t* u = dynamic_cast<unary_base_t*>( e ) )
+    {
+      opcode_e op = unary_op( u -> op_ );
+      bool input_boolean;
+      if ( op == OP_RETURN || ! emit( u -> input, r, input_boolean ) )
+        return false;
+      add( op, r, r );
+      boolean = op == OP_NOT || ( input_boolean && ( op == OP_ABS || op == OP_FLOOR || op == OP_CEIL ) );
+      return true;
+    }
+
+    if ( binary_base_t* b = dynamic_cast<binary_base_t*>( e ) )
+    {
+      bool left_boolean, right_boolean;
+
+      if ( b -> op_ == TOK_AND || b -> op_ == TOK_OR )
+      {
+        if ( ! emit( b -> left, r, left_boolean ) )
+          return false;
+        size_t jump = code.size();
+        add( b -> op_ == TOK_AND ? OP_JUMP_FALSE : OP_JUMP_TRUE, r, r );
+        if ( ! emit( b -> right, r, right_boolean ) )
+          return false;
+        if ( ! right_boolean )
+          add( OP_TRUTH, r, r );
+        code[ jump ].jump = static_cast<uint32_t>( code.size() );
+        boolean = true;
+        return true;
+      }
+
+      if ( b -> op_ == TOK_XOR )
+      {
+        if ( ! emit( b -> left, r, left_boolean ) || ! emit( b -> right, r + 1, right_boolean ) )
+          return false;
+        add( OP_XOR, r, r, r + 1 );
+        boolean = true;
+        return true;
+      }
+
+      if ( b -> right -> is_constant( &value ) )
+        return emit_binary_k( b -> left, b -> op_, value, r, boolean );
+
+      int index = binary_index( b -> op_ );
+      if ( index < 0 || ! emit( b -> left, r, left_boolean ) || ! emit( b -> right, r + 1, right_boolean ) )
+        return false;
+      add( static_cast<opcode_e>( OP_ADD + index ), r, r, r + 1 );
+      boolean = is_comparison( b -> op_ );
+      return true;
+    }
+
+    if ( right_reduced_base_t* b = dynamic_cast<right_reduced_base_t*>( e ) )
+      return emit_binary_k( b -> left, b -> op_, b -> right, r, boolean );
+
+    if ( left_reduced_base_t* b = dynamic_cast<left_reduced_base_t*>( e ) )
+    {
+      int index = binary_index( b -> op_ );
+      bool right_boolean;
+      if ( index < 0 )
+        return false;
+      add( OP_CONST, r ).value = b -> left;
+      if ( ! emit( b -> right, r + 1, right_boolean ) )
+        return false;
+      add( static_cast<opcode_e>( OP_ADD + index ), r, r, r + 1 );
+      boolean = is_comparison( b -> op_ );
+      return true;
+    }
+
+    add( OP_CALL, r ).expr = e;
+    return true;
+  }
+};
+
+class compiled_expr_t : public expr_t
+{
+  expr_t* tree;
+  expr_program_t program;
+
+public:
+  compiled_expr_t( expr_t* t, const expr_program_t& p ) :
+    expr_t( t -> name(), t -> op_ ), tree( t ), program( p )
+  {}
+
+  ~compiled_expr_t() { delete tree; }
+
+  double evaluate() // override
+  { return program.run(); }
+
+  bool is_constant( double* v ) // override
+  { return tree -> is_constant( v ); }
+
+  bool dependencies( expr_deps_t& deps ) // override
+  { return tree -> dependencies( deps ); }
+};
+
+// Incremental Expressions ==================================================
+
+/* Keeps the value of an expression together with the state of its inputs
+ * ( expr_t::dependencies ), and only evaluates it again once one of them
+ * changed, the sim reached a time where the value flips, the action switched
+ * target or a new iteration started. Expressions shared by the whole action
+ * list ( expr_t::optimize_action_list ) have no action.
+ */
+class tracked_expr_t : public expr_t
+{
+  struct value_t
+  {
+    expr_slot_t slot;
+    double seen;
+  };
+
+  struct version_t
+  {
+    const uint64_t* version;
+    uint64_t seen;
+  };
+
+  sim_t& sim;
+  action_t* action;
+  expr_t* tree;
+  std::vector<value_t> values;
+  std::vector<version_t> versions;
+  std::vector<const timespan_t*> times;
+
+  bool valid, reported;
+  double result;
+  timespan_t valid_until;
+  player_t* target;
+  int iteration;
+
+  static double load( const expr_slot_t& s )
+  {
+    switch ( s.type )
+    {
+      case expr_slot_t::SLOT_DOUBLE:   return *static_cast<const double*>( s.address );
+      case expr_slot_t::SLOT_INT:      return *static_cast<const int*>( s.address );
+      case expr_slot_t::SLOT_UNSIGNED: return *static_cast<const unsigned*>( s.address );
+      case expr_slot_t::SLOT_BOOL:     return *static_cast<const bool*>( s.address );
+      case expr_slot_t::SLOT_TIMESPAN: return static_cast<const timespan_t*>( s.address ) -> total_seconds();
+    }
+    return 0;
+  }
+
+  bool current() const
+  {
+    if ( ! valid || iteration != sim.current_iteration || sim.current_time() >= valid_until ||
+         ( action && target != action -> target ) )
+      return false;
+
+    for ( size_t i = 0; i < versions.size(); i++ )
+      if ( *versions[ i ].version != versions[ i ].seen )
+        return false;
+
+    for ( size_t i = 0; i < values.size(); i++ )
+      if ( load( values[ i ].slot ) != values[ i ].seen )
+        return false;
+
+    return true;
+  }
+
+  double update()
+  {
+    for ( size_t i = 0; i < versions.size(); i++ )
+      versions[ i ].seen = *versions[ i ].version;
+
+    for ( size_t i = 0; i < values.size(); i++ )
+      values[ i ].seen = load( values[ i ].slot );
+
+    timespan_t now = sim.current_time();
+    valid_until = timespan_t::max();
+    for ( size_t i = 0; i < times.size(); i++ )
+    {
+      if ( *times[ i ] > now && *times[ i ] < valid_until )
+        valid_until = *times[ i ];
+    }
+
+    target = action ? action -> target : nullptr;
+    iteration = sim.current_iteration;
+    valid = true;
+
+    return result = tree -> eval();
+  }
+
+public:
+  tracked_expr_t( sim_t& s, action_t* a, expr_t* t, const expr_deps_t& deps ) :
+    expr_t( t -> name(), t -> op_ ), sim( s ), action( a ), tree( t ),
+    valid( false ), reported( false ), result( 0 ),
+    valid_until( timespan_t::zero() ), target( nullptr ), iteration( -1 )
+  {
+    // The same input is often referenced more than once, eg. buff.x.up&buff.x.stack<3
+    for ( size_t i = 0; i < deps.values.size(); i++ )
+    {
+      bool seen = false;
+      for ( size_t j = 0; j < values.size(); j++ )
+        seen = seen || ( values[ j ].slot.address == deps.values[ i ].address && values[ j ].slot.type == deps.values[ i ].type );
+      if ( ! seen )
+      {
+        value_t v = { deps.values[ i ], 0 };
+        values.push_back( v );
+      }
+    }
+
+    for ( size_t i = 0; i < deps.versions.size(); i++ )
+    {
+      bool seen = false;
+      for ( size_t j = 0; j < versions.size(); j++ )
+        seen = seen || versions[ j ].version == deps.versions[ i ];
+      if ( ! seen )
+      {
+        version_t v = { deps.versions[ i ], 0 };
+        versions.push_back( v );
+      }
+    }
+
+    for ( size_t i = 0; i < deps.times.size(); i++ )
+    {
+      if ( range::find( times, deps.times[ i ] ) == times.end() )
+        times.push_back( deps.times[ i ] );
+    }
+  }
+
+  ~tracked_expr_t() { delete tree; }
+
+  double evaluate() // override
+  {
+    if ( ! current() )
+      return update();
+
+    if ( sim.incremental_expressions_check )
+    {
+      // Full evaluation has the last word, a difference means an input is
+      // not in the dependencies of the expression
+      double full = tree -> eval();
+      if ( full != result && ! ( std::isnan( full ) && std::isnan( result ) ) )
+      {
+        if ( ! reported )
+        {
+          sim.errorf( "Player %s action %s: incremental expression '%s' reused %f but evaluates to %f at %.3f, missing dependency.\n",
+                      action ? action -> player -> name() : "none", action ? action -> name() : "shared", name().c_str(),
+                      result, full, sim.current_time().total_seconds() );
+          reported = true;
+        }
+        valid = false;
+        return full;
+      }
+    }
+
+    return result;
+  }
+
+  bool is_constant( double* v ) // override
+  { return tree -> is_constant( v ); }
+
+  bool dependencies( expr_deps_t& deps ) // override
+  { return tree -> dependencies( deps ); }
+};
+
+// Action List Optimization =================================================
+
+// Subexpression shared by the action list, owned by the player
+class shared_expr_t : public expr_t
+{
+  std::vector<expr_t*>& pool;
+  size_t index;
+
+public:
+  shared_expr_t( std::vector<expr_t*>& p, size_t i ) :
+    expr_t( p[ i ] -> name(), p[ i ] -> op_ ), pool( p ), index( i )
+  {}
+
+  double evaluate() // override
+  { return pool[ index ] -> eval(); }
+
+  bool is_constant( double* v ) // override
+  { return pool[ index ] -> is_constant( v ); }
+
+  bool range( double& min, double& max ) // override
+  { return pool[ index ] -> range( min, max ); }
+
+  bool dependencies( expr_deps_t& deps ) // override
+  { return pool[ index ] -> dependencies( deps ); }
+};
+
+int count_nodes( expr_t* e )
+{
+  if ( unary_base_t* u = dynamic_cast<unary_base_t*>( e ) )
+    return 1 + count_nodes( u -> input );
+  if ( binary_base_t* b = dynamic_cast<binary_base_t*>( e ) )
+    return 1 + count_nodes( b -> left ) + count_nodes( b -> right );
+  if ( left_reduced_base_t* b = dynamic_cast<left_reduced_base_t*>( e ) )
+    return 1 + count_nodes( b -> right );
+  if ( right_reduced_base_t* b = dynamic_cast<right_reduced_base_t*>( e ) )
+    return 1 + count_nodes( b -> left );
+  return 1;
+}
+
+inline bool surely_zero( double min, double max )
+{ return min == 0 && max == 0; }
+
+inline bool surely_nonzero( double min, double max )
+{ return min > 0 || max < 0; }
+
+/* Range of a binary operator from the ranges of its operands ( l = [a,b],
+ * r = [c,d] ). Comparisons and logical operators always give [0,1], or a
+ * single value when the operand ranges decide it.
+ */
+bool binary_range( token_e op, bool l, double a, double b, bool r, double c, double d,
+                   double& min, double& max )
+{
+  switch ( op )
+  {
+    case TOK_AND:
+      min = 0; max = 1;
+      if ( ( l && surely_zero( a, b ) ) || ( r && surely_zero( c, d ) ) )
+        max = 0;
+      else if ( l && r && surely_nonzero( a, b ) && surely_nonzero( c, d ) )
+        min = 1;
+      return true;
+
+    case TOK_OR:
+      min = 0; max = 1;
+      if ( ( l && surely_nonzero( a, b ) ) || ( r && surely_nonzero( c, d ) ) )
+        min = 1;
+      else if ( l && r && surely_zero( a, b ) && surely_zero( c, d ) )
+        max = 0;
+      return true;
+
+    case TOK_XOR:
+      min = 0; max = 1;
+      if ( l && r && ( surely_zero( a, b ) || surely_nonzero( a, b ) ) && ( surely_zero( c, d ) || surely_nonzero( c, d ) ) )
+        min = max = surely_nonzero( a, b ) != surely_nonzero( c, d );
+      return true;
+
+    case TOK_LT:    min = 0; max = 1; if ( l && r ) { if ( b <  c ) min = 1; if ( a >= d ) max = 0; } return true;
+    case TOK_LTEQ:  min = 0; max = 1; if ( l && r ) { if ( b <= c ) min = 1; if ( a >  d ) max = 0; } return true;
+    case TOK_GT:    min = 0; max = 1; if ( l && r ) { if ( a >  d ) min = 1; if ( b <= c ) max = 0; } return true;
+    case TOK_GTEQ:  min = 0; max = 1; if ( l && r ) { if ( a >= d ) min = 1; if ( b <  c ) max = 0; } return true;
+    case TOK_EQ:
+    case TOK_NOTEQ:
+    {
+      bool equal = l && r && a == b && c == d && a == c;
+      bool differ = l && r && ( b < c || d < a );
+      min = 0; max = 1;
+      if ( equal || differ )
+        min = max = ( op == TOK_EQ ) == equal;
+      return true;
+    }
+
+    case TOK_ADD:
+      if ( ! l || ! r ) return false;
+      min = a + c; max = b + d;
+      break;
+
+    case TOK_SUB:
+      if ( ! l || ! r ) return false;
+      min = a - d; max = b - c;
+      break;
+
+    case TOK_MULT:
+    {
+      if ( ! l || ! r ) return false;
+      double p[ 4 ] = { a * c, a * d, b * c, b * d };
+      min = *std::min_element( p, p + 4 );
+      max = *std::max_element( p, p + 4 );
+      if ( std::isnan( p[ 0 ] ) || std::isnan( p[ 1 ] ) || std::isnan( p[ 2 ] ) || std::isnan( p[ 3 ] ) )
+        return false;
+      break;
+    }
+
+    default:
+      return false;
+  }
+
+  return ! std::isnan( min ) && ! std::isnan( max );
+}
+
+// Smallest and largest value an expression tree can take, false if unknown
+bool range_of( expr_t* e, double& min, double& max )
+{
+  if ( unary_base_t* u = dynamic_cast<unary_base_t*>( e ) )
+  {
+    double a, b;
+    bool known = range_of( u -> input, a, b );
+    switch ( u -> op_ )
+    {
+      case TOK_NOT:
+        min = 0; max = 1;
+        if ( known && surely_zero( a, b ) ) min = 1;
+        if ( known && surely_nonzero( a, b ) ) max = 0;
+        return true;
+      case TOK_MINUS: if ( ! known ) return false; min = -b; max = -a; return true;
+      case TOK_FLOOR: if ( ! known ) return false; min = std::floor( a ); max = std::floor( b ); return true;
+      case TOK_CEIL:  if ( ! known ) return false; min = std::ceil( a );  max = std::ceil( b );  return true;
+      case TOK_ABS:
+        if ( ! known ) return false;
+        min = a >= 0 ? a : b <= 0 ? -b : 0;
+        max = std::max( std::fabs( a ), std::fabs( b ) );
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  double a = 0, b = 0, c = 0, d = 0;
+  if ( binary_base_t* e2 = dynamic_cast<binary_base_t*>( e ) )
+  {
+    bool l = range_of( e2 -> left, a, b ), r = range_of( e2 -> right, c, d );
+    return binary_range( e2 -> op_, l, a, b, r, c, d, min, max );
+  }
+  if ( left_reduced_base_t* e2 = dynamic_cast<left_reduced_base_t*>( e ) )
+    return binary_range( e2 -> op_, true, e2 -> left, e2 -> left, range_of( e2 -> right, c, d ), c, d, min, max );
+  if ( right_reduced_base_t* e2 = dynamic_cast<right_reduced_base_t*>( e ) )
+    return binary_range( e2 -> op_, range_of( e2 -> left, a, b ), a, b, true, e2 -> right, e2 -> right, min, max );
+
+  if ( e -> range( min, max ) )
+    return true;
+
+  // Direct memory reads
+  expr_slot_t s;
+  if ( e -> slot( s ) )
+  {
+    if ( s.compare != TOK_UNKNOWN || s.type == expr_slot_t::SLOT_BOOL )
+    {
+      min = 0; max = 1;
+      return true;
+    }
+    if ( s.type == expr_slot_t::SLOT_UNSIGNED )
+    {
+      min = 0; max = std::numeric_limits<double>::infinity();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Replace every subtree with a statically known value by a constant
+expr_t* fold( expr_t* e )
+{
+  if ( unary_base_t* u = dynamic_cast<unary_base_t*>( e ) )
+    u -> input = fold( u -> input );
+  else if ( binary_base_t* b = dynamic_cast<binary_base_t*>( e ) )
+  {
+    b -> left = fold( b -> left );
+    b -> right = fold( b -> right );
+  }
+  else if ( left_reduced_base_t* b = dynamic_cast<left_reduced_base_t*>( e ) )
+    b -> right = fold( b -> right );
+  else if ( right_reduced_base_t* b = dynamic_cast<right_reduced_base_t*>( e ) )
+    b -> left = fold( b -> left );
+
+  double min, max;
+  if ( e -> is_constant( &min ) || ! range_of( e, min, max ) || min != max )
+    return e;
+
+  if ( EXPRESSION_DEBUG ) printf( "%d %s folded to %f\n", e -> id_, e -> name().c_str(), min );
+  expr_t* folded = new const_expr_t( e -> name(), min );
+  delete e;
+  return folded;
+}
+
+/* Common subexpression elimination. Two subtrees are the same expression when
+ * they have the same operators over the same constants and inputs; a leaf is
+ * identified by its type and the inputs it depends on ( expr_t::slot and
+ * expr_t::dependencies ), so only leaves whose value is a function of their
+ * inputs are ever shared.
+ */
+class expr_sharing_t
+{
+  std::vector<expr_t*>& pool;
+  std::map<std::string, int> count;
+  std::map<std::string, size_t> shared;
+
+  static void append( std::string& key, const char* format, ... )
+  {
+    char buffer[ 128 ];
+    va_list args;
+    va_start( args, format );
+    vsnprintf( buffer, sizeof( buffer ), format, args );
+    va_end( args );
+    key += buffer;
+  }
+
+  static bool key_of( expr_t* e, std::string& key )
+  {
+    if ( unary_base_t* u = dynamic_cast<unary_base_t*>( e ) )
+    {
+      append( key, "u%d(", u -> op_ );
+      if ( ! key_of( u -> input, key ) ) return false;
+      key += ')';
+      return true;
+    }
+    if ( binary_base_t* b = dynamic_cast<binary_base_t*>( e ) )
+    {
+      append( key, "b%d(", b -> op_ );
+      if ( ! key_of( b -> left, key ) ) return false;
+      key += ',';
+      if ( ! key_of( b -> right, key ) ) return false;
+      key += ')';
+      return true;
+    }
+    if ( left_reduced_base_t* b = dynamic_cast<left_reduced_base_t*>( e ) )
+    {
+      append( key, "l%d(%a,", b -> op_, b -> left );
+      if ( ! key_of( b -> right, key ) ) return false;
+      key += ')';
+      return true;
+    }
+    if ( right_reduced_base_t* b = dynamic_cast<right_reduced_base_t*>( e ) )
+    {
+      append( key, "r%d(", b -> op_ );
+      if ( ! key_of( b -> left, key ) ) return false;
+      append( key, ",%a)", b -> right );
+      return true;
+    }
+
+    double value;
+    if ( e -> is_constant( &value ) )
+    {
+      append( key, "k%a", value );
+      return true;
+    }
+
+    expr_slot_t s;
+    if ( e -> slot( s ) )
+    {
+      append( key, "s%d:%p:%d:%a", s.type, s.address, s.compare, s.operand );
+      return true;
+    }
+
+    expr_deps_t deps;
+    if ( ! e -> dependencies( deps ) )
+      return false;
+
+    key += 'd';
+    key += typeid( *e ).name();
+    for ( size_t i = 0; i < deps.values.size(); i++ )
+      append( key, ":v%d:%p", deps.values[ i ].type, deps.values[ i ].address );
+    for ( size_t i = 0; i < deps.versions.size(); i++ )
+      append( key, ":n%p", static_cast<const void*>( deps.versions[ i ] ) );
+    for ( size_t i = 0; i < deps.times.size(); i++ )
+      append( key, ":t%p", static_cast<const void*>( deps.times[ i ] ) );
+    return true;
+  }
+
+  // Single inputs are not worth the indirection
+  static bool candidate( expr_t* e, std::string& key )
+  { return count_nodes( e ) > 1 && key_of( e, key ); }
+
+public:
+  int subexpressions;
+
+  expr_sharing_t( std::vector<expr_t*>& p ) :
+    pool( p ), subexpressions( 0 )
+  {}
+
+  void count_subtrees( expr_t* e )
+  {
+    std::string key;
+    if ( candidate( e, key ) )
+      count[ key ]++;
+
+    if ( unary_base_t* u = dynamic_cast<unary_base_t*>( e ) )
+      count_subtrees( u -> input );
+    else if ( binary_base_t* b = dynamic_cast<binary_base_t*>( e ) )
+    {
+      count_subtrees( b -> left );
+      count_subtrees( b -> right );
+    }
+    else if ( left_reduced_base_t* b = dynamic_cast<left_reduced_base_t*>( e ) )
+      count_subtrees( b -> right );
+    else if ( right_reduced_base_t* b = dynamic_cast<right_reduced_base_t*>( e ) )
+      count_subtrees( b -> left );
+  }
+
+  // Replace the largest repeated subtrees by references to the shared copy
+  expr_t* share( expr_t* e )
+  {
+    std::string key;
+    if ( candidate( e, key ) && count[ key ] > 1 )
+    {
+      std::map<std::string, size_t>::iterator i = shared.find( key );
+      size_t index;
+      if ( i == shared.end() )
+      {
+        index = pool.size();
+        pool.push_back( e );
+        shared[ key ] = index;
+        subexpressions++;
+      }
+      else
+      {
+        index = i -> second;
+        delete e;
+      }
+      return new shared_expr_t( pool, index );
+    }
+
+    if ( unary_base_t* u = dynamic_cast<unary_base_t*>( e ) )
+      u -> input = share( u -> input );
+    else if ( binary_base_t* b = dynamic_cast<binary_base_t*>( e ) )
+    {
+      b -> left = share( b -> left );
+      b -> right = share( b -> right );
+    }
+    else if ( left_reduced_base_t* b = dynamic_cast<left_reduced_base_t*>( e ) )
+      b -> right = share( b -> right );
+    else if ( right_reduced_base_t* b = dynamic_cast<right_reduced_base_t*>( e ) )
+      b -> left = share( b -> left );
+    return e;
+  }
+};
+
+/* Mean time of one evaluation of the conditions of the actor, in seconds: the
+ * sampled time per evaluation of each action, weighted by its calls. Counts the
+ * evaluations up to expr_t::optimize_action_list, or with since_optimize the
+ * ones after it. Per evaluation times do not depend on how many evaluations
+ * each iteration happened to run.
+ */
+double condition_time( const player_t& p, bool since_optimize )
+{
+  double time = 0, calls = 0;
+  for ( size_t i = 0; i < p.action_list.size(); i++ )
+  {
+    const action_t* a = p.action_list[ i ];
+    cpu_profile_t::part_t part = a -> condition_profile;
+    if ( since_optimize )
+    {
+      const cpu_profile_t::part_t& total = a -> cpu_profile.parts[ cpu_profile_t::CONDITION ];
+      part.calls   = total.calls - part.calls;
+      part.samples = total.samples - part.samples;
+      part.time    = total.time - part.time;
+    }
+
+    if ( part.samples == 0 )
+      continue;
+
+    time  += part.time / part.samples * part.calls;
+    calls += part.calls;
+  }
+  return calls > 0 ? time / calls : 0;
+}
+
+} // UNNAMED NAMESPACE ====================================================
+
+// precedence ===============================================================
+
+int expression_t::precedence( token_e expr_token_type )
+{
+  switch ( expr_token_type )
+  {
+    case TOK_FLOOR:
+    case TOK_CEIL:
+      return 8;
+
+    case TOK_NOT:
+    case TOK_PLUS:
+    case TOK_MINUS:
+    case TOK_ABS:
+      return 7;
+
+    case TOK_MULT:
+    case TOK_DIV:
+      return 6;
+
+    case TOK_ADD:
+    case TOK_SUB:
+      return 5;
+
+    case TOK_EQ:
+    case TOK_NOTEQ:
+    case TOK_LT:
+    case TOK_LTEQ:
+    case TOK_GT:
+    case TOK_GTEQ:
+    case TOK_IN:
+    case TOK_NOTIN:
+      return 4;
+
+    case TOK_AND:
+      return 3;
+
+    case TOK_XOR:
+      return 2;
+
+    case TOK_OR:
+      return 1;
+
+    default:
+      assert( false );
+      return 0;
+  }
+}
+
+// is_unary =================================================================
+
+bool expression_t::is_unary( token_e expr_token_type )
+{
+  switch ( expr_token_type )
+  {
+    case TOK_NOT:
+    case TOK_PLUS:
+    case TOK_MINUS:
+    case TOK_ABS:
+    case TOK_FLOOR:
+    case TOK_CEIL:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// is_binary ================================================================
+
+bool expression_t::is_binary( token_e expr_token_type )
+{
+  switch ( expr_token_type )
+  {
+    case TOK_MULT:
+    case TOK_DIV:
+    case TOK_ADD:
+    case TOK_SUB:
+    case TOK_EQ:
+    case TOK_NOTEQ:
+    case TOK_LT:
+    case TOK_LTEQ:
+    case TOK_GT:
+    case TOK_GTEQ:
+    case TOK_AND:
+    case TOK_XOR:
+    case TOK_OR:
+    case TOK_IN:
+    case TOK_NOTIN:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// next_token ===============================================================
+
+token_e expression_t::next_token( action_t* action, const std::string& expr_str,
+                                  int& current_index, std::string& token_str, token_e prev_token )
+{
+  unsigned char c = expr_str[ current_index++ ];
+
+  if ( c == '\0' ) return TOK_UNKNOWN;
+  if ( ( prev_token == TOK_FLOOR || prev_token == TOK_CEIL ) && c != '(' )
+    return TOK_UNKNOWN;
+
+  token_str = c;
+
+  if ( c == '@' ) return TOK_ABS;
+  if ( c == '+' ) return TOK_ADD;
+  if ( c == '-' && ( prev_token == TOK_STR || prev_token == TOK_NUM ) ) return TOK_SUB;
+  if ( c == '-' && prev_token != TOK_STR && prev_token != TOK_NUM && ! isdigit( static_cast<unsigned char>( expr_str[ current_index ] ) ) ) return TOK_SUB;
+  if ( c == '*' ) return TOK_MULT;
+  if ( c == '%' ) return TOK_DIV;
+  if ( c == '&' )
+  {
+    if ( expr_str[ current_index ] == '&' ) current_index++;
+    return TOK_AND;
+  }
+  if ( c == '|' )
+  {
+    if ( expr_str[ current_index ] == '|' ) current_index++;
+    return TOK_OR;
+  }
+  if ( c == '^' )
+  {
+    if ( expr_str[ current_index ] == '^' ) current_index++;
+    return TOK_XOR;
+  }
+  if ( c == '~' )
+  {
+    if ( expr_str[ current_index ] == '~' ) current_index++;
+    return TOK_IN;
+  }
+  if ( c == '!' )
+  {
+    if ( expr_str[ current_index ] == '=' ) { current_index++; token_str += "="; return TOK_NOTEQ; }
+    if ( expr_str[ current_index ] == '~' ) { current_index++; token_str += "~"; return TOK_NOTIN; }
+    return TOK_NOT;
+  }
+  if ( c == '=' )
+  {
+    if ( expr_str[ current_index ] == '=' ) current_index++;
+    return TOK_EQ;
+  }
+  if ( c == '<' )
+  {
+    if ( expr_str[ current_index ] == '=' ) { current_index++; token_str += "="; return TOK_LTEQ; }
+    return TOK_LT;
+  }
+  if ( c == '>' )
+  {
+    if ( expr_str[ current_index ] == '=' ) { current_index++; token_str += "="; return TOK_GTEQ; }
+    return TOK_GT;
+  }
+  if ( c == '(' ) return TOK_LPAR;
+  if ( c == ')' ) return TOK_RPAR;
+
+  if ( isalpha( c ) )
+  {
+    c = expr_str[ current_index ];
+    while ( isalpha( c ) || isdigit( c ) || c == '_' || c == '.' )
+    {
+      token_str += c;
+      c = expr_str[ ++current_index ];
+    }
+
+    if ( util::str_compare_ci( token_str, "floor" ) )
+      return TOK_FLOOR;
+    else if ( util::str_compare_ci( token_str, "ceil" ) )
+      return TOK_CEIL;
+    else
+      return TOK_STR;
+  }
+
+  if ( isdigit( c ) || c == '-' )
+  {
+    c = expr_str[ current_index ];
+    while ( isdigit( c ) || c == '.' )
+    {
+      token_str += c;
+      c = expr_str[ ++current_index ];
+    }
+
+    return TOK_NUM;
+  }
+
+  if ( action )
+  {
+    action -> sim -> errorf( "%s-%s: Unexpected token (%c) in %s\n", action -> player -> name(), action -> name(), c, expr_str.c_str() );
+  }
+  else
+  {
+    printf( "Unexpected token (%c) in %s\n", c, expr_str.c_str() );
+  }
+
+  return TOK_UNKNOWN;
+}
+
+// parse_tokens =============================================================
+
+std::vector<expr_token_t>
+expression_t::parse_tokens( action_t* action,
+                            const std::string& expr_str )
+{
+  std::vector<expr_token_t> tokens;
+
+  expr_token_t token;
+  int current_index = 0;
+  token_e t = TOK_UNKNOWN;
+
+  while ( ( token.type = next_token( action, expr_str, current_index, token.label, t ) ) != TOK_UNKNOWN )
+  {
+    t = token.type;
+    tokens.push_back( token );
+  }
+
+  return tokens;
+}
+
+// print_tokens =============================================================
+
+void expression_t::print_tokens( std::vector<expr_token_t>& tokens, sim_t* sim )
+{
+  std::string str;
+  if ( tokens.size() > 0 )
+    str += "tokens: ";
+
+  for ( size_t i = 0; i < tokens.size(); i++ )
   {
     expr_token_t& t = tokens[ i ];
     str::format( str, "%2d '%s'", t.type, t.label.c_str() );
@@ -987,6 +1965,185 @@ expr_t* expr_t::create_constant( const std::string& name,
   return new const_expr_t( name, value );
 }
 
+// expr_t::compile ==========================================================
+
+/* Lower an ( optimized ) expression tree to bytecode. Ownership of the tree
+ * moves to the returned expression; returns the tree itself if it can not be
+ * compiled or there is nothing to gain.
+ */
+expr_t* expr_t::compile( expr_t* e )
+{
+  if ( ! e ) return e;
+
+  double value;
+  if ( e -> is_constant( &value ) || dynamic_cast<compiled_expr_t*>( e ) )
+    return e;
+
+  expr_program_t program;
+  if ( ! program.build( e ) )
+    return e;
+
+  // A lone call plus return only adds a level of indirection
+  if ( program.code.size() == 2 && program.code[ 0 ].op == expr_program_t::OP_CALL )
+    return e;
+
+  return new compiled_expr_t( e, program );
+}
+
+// expr_t::track ============================================================
+
+/* Reuse the value of the expression until one of its inputs changes. Ownership
+ * of the tree moves to the returned expression; returns the tree itself if
+ * its inputs are not all known.
+ */
+expr_t* expr_t::track( expr_t* e, sim_t& sim, action_t* action )
+{
+  if ( ! e ) return e;
+
+  double value;
+  if ( e -> is_constant( &value ) )
+    return e;
+
+  expr_deps_t deps;
+  if ( ! e -> dependencies( deps ) )
+    return e;
+
+  return new tracked_expr_t( sim, action, e, deps );
+}
+
+// expr_t::optimize_action_list =============================================
+
+/* Passes over all conditions of a player's actions, once the first iteration
+ * has optimized each of them on its own:
+ *  - optimize_action_lists folds subexpressions whose value is known from the
+ *    range of their inputs ( eg. buff.x.stack>5 of a buff stacking to 3 ),
+ *    drops actions that can never be ready from the action lists, and with
+ *    incremental_expressions shares repeated subexpressions between actions,
+ *    so their value is reused by every action
+ *  - compile_expressions lowers the conditions to bytecode
+ *  - incremental_expressions reuses their values while the inputs are the same
+ */
+void expr_t::optimize_action_list( player_t& p )
+{
+  sim_t& sim = *p.sim;
+
+  std::vector<expr_t**> exprs;
+  for ( size_t i = 0; i < p.action_list.size(); i++ )
+  {
+    action_t* a = p.action_list[ i ];
+    expr_t** conditions[] = { &a -> if_expr, &a -> target_if_expr, &a -> interrupt_if_expr, &a -> early_chain_if_expr };
+    for ( size_t j = 0; j < sizeof_array( conditions ); j++ )
+    {
+      if ( *conditions[ j ] )
+        exprs.push_back( conditions[ j ] );
+    }
+  }
+
+  int nodes_before = 0;
+  for ( size_t i = 0; i < exprs.size(); i++ )
+    nodes_before += count_nodes( *exprs[ i ] );
+
+  // The first iteration ran the conditions as parsed, see report_action_list
+  for ( size_t i = 0; i < p.action_list.size(); i++ )
+    p.action_list[ i ] -> condition_profile = p.action_list[ i ] -> cpu_profile.parts[ cpu_profile_t::CONDITION ];
+
+  int nodes_after = 0, pruned = 0, shared = 0;
+
+  if ( sim.optimize_action_lists )
+  {
+    for ( size_t i = 0; i < exprs.size(); i++ )
+      *exprs[ i ] = fold( *exprs[ i ] );
+
+    for ( size_t i = 0; i < p.action_list.size(); i++ )
+    {
+      action_t* a = p.action_list[ i ];
+      if ( ! a -> if_expr || ! a -> if_expr -> always_false() || ! a -> action_list )
+        continue;
+
+      std::vector<action_t*>* lists[] = { &a -> action_list -> foreground_action_list, &a -> action_list -> off_gcd_actions };
+      bool found = false;
+      for ( size_t j = 0; j < sizeof_array( lists ); j++ )
+      {
+        std::vector<action_t*>::iterator it = range::find( *lists[ j ], a );
+        if ( it == lists[ j ] -> end() ) continue;
+        lists[ j ] -> erase( it );
+        found = true;
+      }
+      if ( found ) pruned++;
+    }
+
+    // Without reuse of values, sharing would only add an indirection
+    if ( sim.incremental_expressions )
+    {
+      expr_sharing_t sharing( p.shared_expressions );
+      for ( size_t i = 0; i < exprs.size(); i++ )
+        sharing.count_subtrees( *exprs[ i ] );
+      for ( size_t i = 0; i < exprs.size(); i++ )
+        *exprs[ i ] = sharing.share( *exprs[ i ] );
+      shared = sharing.subexpressions;
+    }
+  }
+
+  for ( size_t i = 0; i < exprs.size(); i++ )
+    nodes_after += count_nodes( *exprs[ i ] );
+  for ( size_t i = 0; i < p.shared_expressions.size(); i++ )
+    nodes_after += count_nodes( p.shared_expressions[ i ] );
+
+  if ( sim.compile_expressions )
+  {
+    for ( size_t i = 0; i < p.shared_expressions.size(); i++ )
+      p.shared_expressions[ i ] = compile( p.shared_expressions[ i ] );
+    for ( size_t i = 0; i < exprs.size(); i++ )
+      *exprs[ i ] = compile( *exprs[ i ] );
+  }
+
+  if ( sim.incremental_expressions )
+  {
+    for ( size_t i = 0; i < p.shared_expressions.size(); i++ )
+      p.shared_expressions[ i ] = track( p.shared_expressions[ i ], sim );
+
+    // target_if= is evaluated against every candidate, it would never stay cached
+    for ( size_t i = 0; i < p.action_list.size(); i++ )
+    {
+      action_t* a = p.action_list[ i ];
+      a -> if_expr = track( a -> if_expr, sim, a );
+      a -> interrupt_if_expr = track( a -> interrupt_if_expr, sim, a );
+      a -> early_chain_if_expr = track( a -> early_chain_if_expr, sim, a );
+    }
+  }
+
+  if ( sim.optimize_action_lists && ! sim.parent && ! exprs.empty() )
+  {
+    sim.out_std.printf( "Player %s action list: %d -> %d expression nodes, %d shared subexpressions, %d actions pruned",
+                        p.name(), nodes_before, nodes_after, shared, pruned );
+  }
+}
+
+// expr_t::report_action_list ===============================================
+
+/* With profile_cpu, print the time of one condition evaluation during the
+ * first iteration, which ran the conditions as parsed, and the second one,
+ * which ran them after optimize_action_list. Both are measured on the actual
+ * evaluations of the action lists, so the comparison does not evaluate
+ * anything on its own. Iterations differ in length and in the actions they
+ * reach, so time per evaluation is compared instead of the total time.
+ */
+void expr_t::report_action_list( player_t& p )
+{
+  sim_t& sim = *p.sim;
+
+  if ( ! sim.optimize_action_lists || sim.parent || sim.profile_cpu <= 0 )
+    return;
+
+  double before = condition_time( p, false );
+  double after = condition_time( p, true );
+  if ( before <= 0 || after <= 0 )
+    return;
+
+  sim.out_std.printf( "Player %s action list: %.0f -> %.0f ns per condition evaluation",
+                      p.name(), before * 1e9, after * 1e9 );
+}
+
 // action_expr_t::parse =====================================================
 
 expr_t* expr_t::parse( action_t* action,
@@ -1051,29 +2208,296 @@ void time_test( expr_t* expr, uint64_t n )
   const int64_t stop = util::milliseconds();
   printf( "evaluate: %f in %.4f seconds\n", value, ( stop - start ) / 1000.0 );
 }
+
+// Random expression trees ==================================================
+
+std::mt19937_64 test_gen( 42 );
+double     test_double[ 4 ];
+int        test_int[ 4 ];
+bool       test_bool[ 2 ];
+timespan_t test_time[ 2 ];
+int        test_calls = 0; // Evaluations of function leaves
+
+// Buff stack like leaf, read through its slot and optionally compared to 0
+class test_stack_expr_t : public expr_t
+{
+  int& stack;
+  token_e compare;
+
+public:
+  test_stack_expr_t( int& s, token_e c ) :
+    expr_t( "stack" ), stack( s ), compare( c ) {}
+
+  double evaluate() // override
+  { return compare == TOK_GT ? stack > 0 : compare == TOK_LTEQ ? stack <= 0 : stack; }
+
+  bool slot( expr_slot_t& s ) // override
+  { s.set( stack ); s.compare = compare; return true; }
+};
+
+expr_t* random_leaf()
+{
+  switch ( test_gen() % 8 )
+  {
+    case 0: return new const_expr_t( "k", int( test_gen() % 7 ) - 2 );
+    case 1: return make_ref_expr( "d", test_double[ test_gen() % 4 ] );
+    case 2: return make_ref_expr( "i", test_int[ test_gen() % 4 ] );
+    case 3: return make_ref_expr( "b", test_bool[ test_gen() % 2 ] );
+    case 4: return make_ref_expr( "t", test_time[ test_gen() % 2 ] );
+    case 5:
+    {
+      double* d = &test_double[ test_gen() % 4 ];
+      return make_fn_expr( "fn", [ d ]() { ++test_calls; return *d; } );
+    }
+    case 6:
+    {
+      token_e compare[] = { TOK_GT, TOK_LTEQ, TOK_UNKNOWN };
+      return new test_stack_expr_t( test_int[ test_gen() % 4 ], compare[ test_gen() % 3 ] );
+    }
+    default: return new const_expr_t( "k", 0.5 );
+  }
+}
+
+expr_t* random_tree( int depth, bool analyze )
+{
+  if ( depth == 0 || test_gen() % 4 == 0 )
+    return random_leaf();
+
+  if ( test_gen() % 5 == 0 )
+  {
+    token_e unary[] = { TOK_MINUS, TOK_NOT, TOK_ABS, TOK_FLOOR, TOK_CEIL };
+    token_e op = unary[ test_gen() % sizeof_array( unary ) ];
+    expr_t* input = random_tree( depth - 1, analyze );
+    return analyze ? select_analyze_unary( "u", op, input ) : select_unary( "u", op, input );
+  }
+
+  token_e binary[] = { TOK_AND, TOK_OR, TOK_XOR, TOK_ADD, TOK_SUB, TOK_MULT, TOK_DIV,
+                       TOK_EQ, TOK_NOTEQ, TOK_LT, TOK_LTEQ, TOK_GT, TOK_GTEQ };
+  token_e op = binary[ test_gen() % sizeof_array( binary ) ];
+  expr_t* left = random_tree( depth - 1, analyze );
+  expr_t* right = random_tree( depth - 1, analyze );
+  return analyze ? select_analyze_binary( "b", op, left, right ) : select_binary( "b", op, left, right );
 }
 
-void sim_t::cancel() {}
+void randomize_inputs()
+{
+  for ( size_t i = 0; i < sizeof_array( test_double ); i++ )
+    test_double[ i ] = ( int( test_gen() % 5 ) - 1 ) * ( test_gen() % 2 ? 1 : 0.5 );
+  for ( size_t i = 0; i < sizeof_array( test_int ); i++ )
+    test_int[ i ] = int( test_gen() % 4 ) - 1;
+  for ( size_t i = 0; i < sizeof_array( test_bool ); i++ )
+    test_bool[ i ] = test_gen() % 2 != 0;
+  for ( size_t i = 0; i < sizeof_array( test_time ); i++ )
+    test_time[ i ] = timespan_t::from_millis( int( test_gen() % 3000 ) );
+}
 
-int sim_t::errorf( const char *format, ... )
+bool same_value( double a, double b )
+{ return a == b || ( std::isnan( a ) && std::isnan( b ) ); }
+
+/* The bytecode of expr_t::compile has to give the same value as the tree it
+ * was built from, and evaluate the same leaves, for random trees with and
+ * without the analyzing operators.
+ */
+bool test_compile()
 {
-  va_list ap;
-  va_start( ap, format );
-  int result = vfprintf( stderr, format, ap );
-  va_end( ap );
-  return result;
+  int trees = 0, compiled = 0, mismatches = 0;
+
+  for ( int n = 0; n < 20000; n++ )
+  {
+    bool analyze = n % 2 != 0;
+    expr_t* tree = random_tree( 1 + test_gen() % 7, analyze );
+    if ( analyze )
+    {
+      randomize_inputs();
+      for ( int i = 0; i < 5; i++ )
+        tree -> eval();
+      tree = tree -> optimize();
+    }
+
+    // The compiled expression owns the tree, and keeps it intact
+    expr_t* program = expr_t::compile( tree );
+    trees++;
+    if ( program != tree )
+      compiled++;
+
+    for ( int i = 0; i < 20; i++ )
+    {
+      randomize_inputs();
+      test_calls = 0;
+      double tree_value = tree -> eval();
+      int tree_calls = test_calls;
+      test_calls = 0;
+      double program_value = program -> eval();
+
+      if ( ! same_value( tree_value, program_value ) || tree_calls != test_calls )
+      {
+        if ( mismatches++ < 10 )
+          printf( "tree %d: %f in %d calls, compiled %f in %d calls\n", n, tree_value, tree_calls, program_value, test_calls );
+      }
+    }
+
+    delete program;
+  }
+
+  printf( "compile: %d random trees, %d compiled, %d mismatches\n", trees, compiled, mismatches );
+  return mismatches == 0;
+}
+
+// Stack of a buff that stacks to 3, known to the range folding
+class test_buff_stack_expr_t : public expr_t
+{
+  int& input;
+  uint64_t& version;
+
+public:
+  test_buff_stack_expr_t( int& i, uint64_t& v ) :
+    expr_t( "stack" ), input( i ), version( v ) {}
+
+  double evaluate() // override
+  { ++test_calls; return input + 1; }
+
+  bool range( double& min, double& max ) // override
+  { min = 0; max = 3; return true; }
+
+  bool dependencies( expr_deps_t& deps ) // override
+  { deps.versions.push_back( &version ); return true; }
+};
+
+uint64_t test_version[ 4 ];
+
+expr_t* random_stack_leaf()
+{
+  size_t i = test_gen() % 4;
+  return new test_buff_stack_expr_t( test_int[ i ], test_version[ i ] );
+}
+
+expr_t* random_condition( int depth )
+{
+  if ( depth == 0 || test_gen() % 4 == 0 )
+  {
+    switch ( test_gen() % 4 )
+    {
+      case 0: return new const_expr_t( "k", int( test_gen() % 7 ) - 2 );
+      case 1: return make_ref_expr( "d", test_double[ test_gen() % 4 ] );
+      case 2: return random_stack_leaf();
+      default: return random_leaf();
+    }
+  }
+
+  token_e binary[] = { TOK_AND, TOK_OR, TOK_ADD, TOK_LT, TOK_GTEQ, TOK_GT, TOK_MULT };
+  token_e op = binary[ test_gen() % sizeof_array( binary ) ];
+  expr_t* left = random_condition( depth - 1 );
+  expr_t* right = random_condition( depth - 1 );
+  return select_binary( "b", op, left, right );
 }
 
-void sim_t::output( sim_t*, const char *format, ... )
+/* Range folding: buff.x.stack>5 of a buff stacking to 3 is always false, and
+ * so is an && with it, which is what prunes an action. A comparison the range
+ * does not decide stays.
+ */
+bool test_fold()
+{
+  bool ok = true;
+
+  expr_t* e = fold( select_binary( "gt", TOK_GT, random_stack_leaf(), new const_expr_t( "k", 5 ) ) );
+  ok &= e -> always_false();
+  delete e;
+
+  e = fold( select_binary( "and", TOK_AND,
+                           make_ref_expr( "d", test_double[ 0 ] ),
+                           select_binary( "gt", TOK_GT, random_stack_leaf(), new const_expr_t( "k", 5 ) ) ) );
+  ok &= e -> always_false();
+  delete e;
+
+  e = fold( select_binary( "or", TOK_OR,
+                           make_ref_expr( "d", test_double[ 0 ] ),
+                           select_binary( "lteq", TOK_LTEQ, random_stack_leaf(), new const_expr_t( "k", 3 ) ) ) );
+  double value;
+  ok &= e -> is_constant( &value ) && value == 1;
+  delete e;
+
+  e = fold( select_binary( "gt", TOK_GT, random_stack_leaf(), new const_expr_t( "k", 2 ) ) );
+  ok &= ! e -> is_constant( &value );
+  delete e;
+
+  printf( "fold: %s\n", ok ? "ok" : "FAILED" );
+  return ok;
+}
+
+/* Folding and sharing of random action lists has to give the same values as
+ * the conditions as parsed, and a shared subexpression has to be one tree
+ * referenced from every use.
+ */
+bool test_action_list()
+{
+  int folded = 0, shared = 0, mismatches = 0;
+
+  for ( int n = 0; n < 5000; n++ )
+  {
+    std::vector<expr_t*> parsed, optimized, pool;
+
+    std::mt19937_64 state = test_gen;
+    for ( int i = 0; i < 8; i++ )
+      parsed.push_back( random_condition( 1 + test_gen() % 4 ) );
+    test_gen = state;
+    for ( int i = 0; i < 8; i++ )
+    {
+      expr_t* e = random_condition( 1 + test_gen() % 4 );
+      int nodes = count_nodes( e );
+      e = fold( e );
+      if ( count_nodes( e ) != nodes )
+        folded++;
+      optimized.push_back( e );
+    }
+
+    expr_sharing_t sharing( pool );
+    for ( size_t i = 0; i < optimized.size(); i++ )
+      sharing.count_subtrees( optimized[ i ] );
+    for ( size_t i = 0; i < optimized.size(); i++ )
+      optimized[ i ] = expr_t::compile( sharing.share( optimized[ i ] ) );
+    shared += sharing.subexpressions;
+
+    for ( int step = 0; step < 20; step++ )
+    {
+      randomize_inputs();
+      for ( size_t i = 0; i < parsed.size(); i++ )
+      {
+        double a = parsed[ i ] -> eval(), b = optimized[ i ] -> eval();
+        if ( ! same_value( a, b ) && mismatches++ < 10 )
+          printf( "action list %d, condition %d: parsed %f, optimized %f\n", n, static_cast<int>( i ), a, b );
+      }
+    }
+
+    range::dispose( parsed );
+    range::dispose( optimized );
+    range::dispose( pool );
+  }
+
+  printf( "action list: %d conditions folded, %d subexpressions shared, %d mismatches\n", folded, shared, mismatches );
+  return mismatches == 0 && folded > 0 && shared > 0;
+}
+}
+
+void sim_t::cancel() {}
+
+void sim_t::errorf( const char *format, ... )
 {
   va_list ap;
   va_start( ap, format );
-  vfprintf( stdout, format, ap );
+  vfprintf( stderr, format, ap );
   va_end( ap );
 }
 
 int main( int argc, char** argv )
 {
+  if ( argc == 1 )
+  {
+    bool ok = test_compile();
+    ok &= test_fold();
+    ok &= test_action_list();
+    return ok ? 0 : 1;
+  }
+
   uint64_t n_evals = 1;
 
   for ( int i = 1; i < argc; i++ )
@@ -0,0 +1,144 @@
+// ==========================================================================
+// Dedmonwakeen's Raid DPS/TPS Simulator.
+// Send questions to natehieter@gmail.com
+// ==========================================================================
+
+#include "simulationcraft.hpp"
+
+namespace { // UNNAMED NAMESPACE ==========================================
+
+// SplitMix64 finalizer, turns structured keys into well mixed random bits
+uint64_t mix( uint64_t z )
+{
+  z += 0x9E3779B97F4A7C15ULL;
+  z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+  z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+  return z ^ ( z >> 31 );
+}
+
+uint64_t key( uint64_t seed, uint64_t a, uint64_t b, uint64_t c )
+{ return mix( mix( mix( seed ^ a ) ^ b ) ^ c ); }
+
+// Uniform double in [0,1) from random bits
+double unit( uint64_t bits )
+{ return ( bits >> 11 ) * ( 1.0 / 9007199254740992.0 ); }
+
+} // UNNAMED NAMESPACE ====================================================
+
+iteration_design_t::iteration_design_t( sim_t& s ) :
+  sim( s ), design_str( "sweep" ), design( DESIGN_SWEEP ), strata( 20 ), order()
+{
+}
+
+// iteration_design_t::init =================================================
+
+bool iteration_design_t::init()
+{
+  if ( util::str_compare_ci( design_str, "sweep" ) )
+    design = DESIGN_SWEEP;
+  else if ( util::str_compare_ci( design_str, "stratified" ) )
+    design = DESIGN_STRATIFIED;
+  else if ( util::str_compare_ci( design_str, "antithetic" ) )
+    design = DESIGN_ANTITHETIC;
+  else if ( util::str_compare_ci( design_str, "latin_hypercube" ) )
+    design = DESIGN_LATIN_HYPERCUBE;
+  else
+  {
+    sim.errorf( "Unknown iteration_design '%s', use sweep, stratified, antithetic or latin_hypercube.\n", design_str.c_str() );
+    return false;
+  }
+
+  if ( strata < 1 )
+  {
+    sim.errorf( "iteration_design_strata must be at least 1.\n" );
+    strata = 1;
+  }
+
+  return true;
+}
+
+// iteration_design_t::time_adjust ==========================================
+
+double iteration_design_t::time_adjust() const
+{ return adjust( 0 ); }
+
+// iteration_design_t::health_adjust ========================================
+
+double iteration_design_t::health_adjust() const
+{ return adjust( design == DESIGN_LATIN_HYPERCUBE ? 1 : 0 ); }
+
+// iteration_design_t::adjust ===============================================
+
+double iteration_design_t::adjust( unsigned dimension ) const
+{
+  if ( sim.iterations <= 1 )
+    return 1.0;
+
+  if ( design == DESIGN_SWEEP )
+  {
+    if ( sim.deterministic )
+    {
+      // Depend on the iteration alone, not on how far the other threads are
+      if ( sim.current_index <= 0 )
+        return 1.0;
+
+      double pct = sim.current_index / static_cast<double>( sim.work_queue -> size() );
+      return 1.0 + sim.vary_combat_length * ( ( sim.current_index % 2 ) ? 1 : -1 ) * pct;
+    }
+
+    if ( sim.current_iteration == 0 )
+      return 1.0;
+
+    auto progress = sim.work_queue -> progress();
+    return 1.0 + sim.vary_combat_length * ( ( sim.current_iteration % 2 ) ? 1 : -1 ) * progress.pct();
+  }
+
+  // Warm-up iterations are not claimed from the work queue, so they have no
+  // index ( and their data is not collected ).
+  if ( sim.current_index < 0 )
+    return 1.0;
+
+  return 1.0 + sim.vary_combat_length * ( 2.0 * sample( sim.current_index, dimension ) - 1.0 );
+}
+
+// iteration_design_t::sample ===============================================
+
+/* Point in [0,1) of the iteration with the given work queue index. Only
+ * depends on the index and the sim seed, which all threads share, so every
+ * block of consecutive indices is balanced regardless of which thread ran
+ * which iteration, or whether the queue was cut short by target_error.
+ */
+double iteration_design_t::sample( int index, unsigned dimension ) const
+{
+  if ( design == DESIGN_ANTITHETIC )
+  {
+    int pair = index / 2;
+    int block = pair / strata, slot = pair % strata;
+    int stratum = permute( slot, strata, key( sim.seed, block, dimension, 1 ) );
+    double u = ( stratum + unit( key( sim.seed, pair, dimension, 2 ) ) ) / strata;
+    return ( index % 2 ) ? 1.0 - u : u;
+  }
+
+  int block = index / strata, slot = index % strata;
+  int stratum = permute( slot, strata, key( sim.seed, block, dimension, 1 ) );
+  return ( stratum + unit( key( sim.seed, index, dimension, 2 ) ) ) / strata;
+}
+
+// iteration_design_t::permute =============================================
+
+// Position of 'slot' in a random permutation of [0,n), chosen by 'bits'
+int iteration_design_t::permute( int slot, int n, uint64_t bits ) const
+{
+  order.resize( n );
+  for ( int i = 0; i < n; ++i )
+    order[ i ] = i;
+
+  // Fisher-Yates shuffle
+  for ( int i = n - 1; i > 0; --i )
+  {
+    bits = mix( bits );
+    std::swap( order[ i ], order[ bits % static_cast<uint64_t>( i + 1 ) ] );
+  }
+
+  return order[ slot ];
+}
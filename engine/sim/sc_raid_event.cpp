@@ -217,8 +217,7 @@ struct adds_event_t : public raid_event_t
         }
 
         adds[i] -> summon( saved_duration );
-        adds[i] -> x_position = x_offset + spawn_x_coord;
-        adds[i] -> y_position = y_offset + spawn_y_coord;
+        adds[i] -> set_position( x_offset + spawn_x_coord, y_offset + spawn_y_coord );
 
         if ( sim -> log )
         {
@@ -290,8 +289,7 @@ struct move_enemy_t : public raid_event_t
   {
     if ( enemy )
     {
-      enemy -> x_position = 0;
-      enemy -> y_position = 0;
+      enemy -> set_position( 0, 0 );
     }
   }
 
@@ -301,8 +299,7 @@ struct move_enemy_t : public raid_event_t
     {
       original_x = enemy -> x_position;
       original_y = enemy -> y_position;
-      enemy -> x_position = x_coord;
-      enemy -> y_position = y_coord;
+      enemy -> set_position( x_coord, y_coord );
       regenerate_cache();
     }
   }
@@ -311,8 +308,7 @@ struct move_enemy_t : public raid_event_t
   {
     if ( enemy )
     {
-      enemy -> x_position = 0;
-      enemy -> y_position = 0;
+      enemy -> set_position( 0, 0 );
       regenerate_cache();
     }
   }
@@ -88,6 +88,92 @@ struct compare_scale_factors
   }
 };
 
+// paired_samples_t =========================================================
+
+/* Statistics of the ref and delta sim samples of a scale metric, paired by
+ * iteration index. With common random numbers both sims replay the same random
+ * numbers for an iteration, so the pairs are correlated and the variance of
+ * their difference is smaller than the sum of both variances.
+ */
+struct paired_samples_t
+{
+  size_t count;
+  double ref_variance, delta_variance, covariance;
+
+  paired_samples_t() : count( 0 ), ref_variance( 0 ), delta_variance( 0 ), covariance( 0 ) {}
+
+  double correlation() const
+  { return ref_variance > 0 && delta_variance > 0 ? covariance / sqrt( ref_variance * delta_variance ) : 0.0; }
+
+  double difference_variance() const
+  { return std::max( 0.0, ref_variance + delta_variance - 2.0 * covariance ); }
+
+  // Iterations two independent sims would need per iteration of the paired sims for the same error
+  double variance_reduction() const
+  { return difference_variance() > 0 ? ( ref_variance + delta_variance ) / difference_variance() : 0.0; }
+
+  bool pair( const player_t* ref_p, const player_t* delta_p, scale_metric_e sm )
+  {
+    const std::vector<int>* ref_index = nullptr;
+    const std::vector<int>* delta_index = nullptr;
+    const extended_sample_data_t* ref_sd = ref_p -> scaling_sample_data( sm, ref_index );
+    const extended_sample_data_t* delta_sd = delta_p -> scaling_sample_data( sm, delta_index );
+    if ( ! ref_sd || ! delta_sd )
+      return false;
+    if ( ref_sd -> data().size() != ref_index -> size() || delta_sd -> data().size() != delta_index -> size() )
+      return false;
+
+    // Ref sample of each iteration index
+    std::vector<double> ref_values;
+    std::vector<bool> ref_found;
+    for ( size_t i = 0; i < ref_index -> size(); ++i )
+    {
+      size_t index = static_cast<size_t>( ( *ref_index )[ i ] );
+      if ( index >= ref_values.size() )
+      {
+        ref_values.resize( index + 1 );
+        ref_found.resize( index + 1 );
+      }
+      ref_values[ index ] = ref_sd -> data()[ i ];
+      ref_found[ index ] = true;
+    }
+
+    std::vector<std::pair<double, double>> pairs;
+    for ( size_t i = 0; i < delta_index -> size(); ++i )
+    {
+      size_t index = static_cast<size_t>( ( *delta_index )[ i ] );
+      if ( index < ref_found.size() && ref_found[ index ] )
+        pairs.push_back( std::make_pair( ref_values[ index ], delta_sd -> data()[ i ] ) );
+    }
+
+    count = pairs.size();
+    if ( count < 2 )
+      return false;
+
+    double ref_mean = 0, delta_mean = 0;
+    for ( size_t i = 0; i < count; ++i )
+    {
+      ref_mean += pairs[ i ].first;
+      delta_mean += pairs[ i ].second;
+    }
+    ref_mean /= count;
+    delta_mean /= count;
+
+    for ( size_t i = 0; i < count; ++i )
+    {
+      double r = pairs[ i ].first - ref_mean, d = pairs[ i ].second - delta_mean;
+      ref_variance += r * r;
+      delta_variance += d * d;
+      covariance += r * d;
+    }
+    ref_variance /= count - 1;
+    delta_variance /= count - 1;
+    covariance /= count - 1;
+
+    return true;
+  }
+};
+
 } // UNNAMED NAMESPACE ====================================================
 
 // ==========================================================================
@@ -112,7 +198,10 @@ scaling_t::scaling_t( sim_t* s ) :
   current_scaling_stat( STAT_NONE ),
   num_scaling_stats( 0 ),
   remaining_scaling_stats( 0 ),
-  scale_over(), scaling_metric( SCALE_METRIC_NONE ), scale_over_player()
+  scale_over(), scaling_metric( SCALE_METRIC_NONE ), scale_over_player(),
+  scale_factor_concurrency( 0 ),
+  common_random_numbers( 0 ),
+  completed_sims( 0 )
 {
   create_options();
 }
@@ -139,6 +228,21 @@ double scaling_t::progress( std::string& phase, std::string* detailed )
 
   int completed_scaling_stats = ( num_scaling_stats - remaining_scaling_stats );
 
+  if ( ! concurrent_sims.empty() )
+  {
+    // Concurrent pass: progress over all delta sims, whichever stat they belong to
+    double sims_progress = completed_sims;
+    for ( size_t i = 0; i < concurrent_sims.size(); ++i )
+    {
+      if ( concurrent_sims[ i ] -> current_iteration >= 0 )
+        sims_progress += clamp( concurrent_sims[ i ] -> progress().pct(), 0.0, 1.0 );
+    }
+
+    sim -> detailed_progress( detailed, completed_scaling_stats, num_scaling_stats );
+
+    return sims_progress / ( completed_sims + concurrent_sims.size() );
+  }
+
   double stat_progress = completed_scaling_stats / static_cast<double>( num_scaling_stats );
 
   sim -> detailed_progress( detailed, completed_scaling_stats, num_scaling_stats );
@@ -217,6 +321,24 @@ void scaling_t::analyze_stats()
   baseline_sim = sim; // Take the current sim as baseline
   mutex.unlock();
 
+  int concurrency = scale_factor_concurrency > 0 ? scale_factor_concurrency : sim -> threads;
+  if ( concurrency > 1 && num_scaling_stats > 1 )
+  {
+    analyze_stats_concurrent( stats_to_scale, concurrency );
+  }
+  else
+  {
+    analyze_stats_sequential( stats_to_scale );
+  }
+
+  if ( baseline_sim != sim ) delete baseline_sim;
+  baseline_sim = nullptr;
+}
+
+// scaling_t::analyze_stats_sequential ======================================
+
+void scaling_t::analyze_stats_sequential( const std::vector<stat_e>& stats_to_scale )
+{
   for ( size_t k = 0; k < stats_to_scale.size(); ++k )
   {
     if ( sim -> is_canceled() ) break;
@@ -231,120 +353,323 @@ void scaling_t::analyze_stats()
 
     mutex.lock();
     ref_sim = baseline_sim;
-    delta_sim = new sim_t( sim );
+    delta_sim = create_delta_sim( stat, +scale_delta / ( center ? 2 : 1 ), false );
     mutex.unlock();
 
-    if ( sim -> report_progress )
-    {
-      std::stringstream  stat_name; stat_name.width( 12 );
-      stat_name << std::left << std::string( util::stat_type_abbrev( stat ) ) + ":";
-      delta_sim -> sim_phase_str = "Generating " + stat_name.str();
-      //util::fprintf( stdout, "\nGenerating scale factors for %s...\n", util::stat_type_string( stat ) );
-      //fflush( stdout );
-    }
-
-    delta_sim -> scaling -> scale_stat = stat;
-    delta_sim -> scaling -> scale_value = +scale_delta / ( center ? 2 : 1 );
     delta_sim -> execute();
 
     if ( center )
     {
       mutex.lock();
-      ref_sim = new sim_t( sim );
+      ref_sim = create_delta_sim( stat, -( scale_delta / 2 ), true );
       mutex.unlock();
 
-      if ( sim -> report_progress )
-      {
-        std::stringstream  stat_name; stat_name.width( 8 );
-        stat_name << std::left << std::string( util::stat_type_abbrev( stat ) ) + ":";
-        ref_sim -> sim_phase_str = "Generating ref " + stat_name.str();
-      }
-
-      ref_sim -> scaling -> scale_stat = stat;
-      ref_sim -> scaling -> scale_value = center ? -( scale_delta / 2 ) : 0;
       ref_sim -> execute();
     }
 
-    for ( size_t j = 0; j < sim -> players_by_name.size(); j++ )
+    analyze_stat_results( stat, scale_delta, center, ref_sim, delta_sim );
+
+    mutex.lock();
+    if ( ref_sim != baseline_sim && ref_sim != sim )
     {
-      player_t* p = sim -> players_by_name[ j ];
+      delete ref_sim;
+      ref_sim = nullptr;
+    }
+    delete delta_sim;  
+    delta_sim  = nullptr;
+    remaining_scaling_stats--;
+    mutex.unlock();
+  }
+}
 
-      if ( ! p -> scales_with[ stat ] ) continue;
+// scaling_t::analyze_stats_concurrent ======================================
 
-      player_t*   ref_p =   ref_sim -> find_player( p -> name() );
-      player_t* delta_p = delta_sim -> find_player( p -> name() );
-      assert( ref_p && "Reference Player not found" );
-      assert( delta_p && "Delta player not found" );
+/* Runs the delta (and centered reference) sims of all scaling stats at the
+ * same time, instead of one stat after the other. The thread budget of the
+ * baseline sim is shared between at most 'concurrency' sims, so each sim runs
+ * with few threads and the per-sim startup, merge and analysis phases of one
+ * sim overlap with the iterations of the others.
+ *
+ * Sims are started in stat order; before running, the delta sims of the
+ * different stats cannot be told apart by cost. A sim started when fewer sims
+ * remain than there are free slots is given the remaining threads, so the
+ * tail of the pass does not leave cores idle.
+ *
+ * With deterministic=1 every sim keeps the full thread count of the baseline
+ * sim, as in a sequential pass. To keep the number of OS threads in check,
+ * only concurrency / threads of them run at once ( at least one ), so by
+ * default they run one after the other.
+ */
 
-      double divisor = scale_delta;
+void scaling_t::analyze_stats_concurrent( const std::vector<stat_e>& stats_to_scale, int concurrency )
+{
+  struct job_t
+  {
+    stat_e stat;
+    double scale_delta;
+    bool center;
+    sim_t* ref_sim;
+    sim_t* delta_sim;
+    int pending_sims;
+  };
+
+  struct task_t
+  {
+    size_t job;
+    sim_t* sim;
+  };
 
-      if ( delta_p -> invert_scaling )
-        divisor = -divisor;
+  std::vector<job_t> jobs;
+  std::vector<task_t> tasks;
 
-      if ( divisor < 0.0 ) divisor += ref_p -> over_cap[ stat ];
+  // Construct all sims up front on this thread; the expensive player setup
+  // happens later in sim_t::init, on the thread running the sim.
+  mutex.lock();
+  for ( size_t k = 0; k < stats_to_scale.size(); ++k )
+  {
+    stat_e stat = stats_to_scale[ k ];
+    double scale_delta = stats.get_stat( stat );
+    assert( scale_delta );
+
+    job_t job;
+    job.stat = stat;
+    job.scale_delta = scale_delta;
+    job.center = center_scale_delta && ! stat_may_cap( stat );
+    job.delta_sim = create_delta_sim( stat, +scale_delta / ( job.center ? 2 : 1 ), false );
+    job.ref_sim = job.center ? create_delta_sim( stat, -( scale_delta / 2 ), true ) : baseline_sim;
+    job.pending_sims = job.center ? 2 : 1;
+    jobs.push_back( job );
+
+    tasks.push_back( { jobs.size() - 1, job.delta_sim } );
+    if ( job.center )
+      tasks.push_back( { jobs.size() - 1, job.ref_sim } );
+  }
+  concurrent_sims.clear();
+  completed_sims = 0;
+  for ( size_t i = 0; i < tasks.size(); ++i )
+    concurrent_sims.push_back( tasks[ i ].sim );
+  current_scaling_stat = stats_to_scale.front();
+  mutex.unlock();
 
-      for ( scale_metric_e sm = SCALE_METRIC_NONE; sm < SCALE_METRIC_MAX; sm++ )
-      {
+  struct sim_thread_t : public sc_thread_t
+  {
+    sim_t* sim;
+    size_t task;
+    int threads;
+    std::atomic<bool> finished;
 
-        double delta_score = delta_p -> scaling_for_metric( sm ).value;
-        double   ref_score = ref_p -> scaling_for_metric( sm ).value;
+    sim_thread_t( sim_t* s, size_t t, int n ) :
+      sim( s ), task( t ), threads( n ), finished( false )
+    { }
 
-        double delta_error = delta_p -> scaling_for_metric( sm ).stddev * delta_sim -> confidence_estimator;
-        double   ref_error = ref_p -> scaling_for_metric( sm ).stddev * ref_sim -> confidence_estimator;
+    void run() override
+    {
+      sim -> threads = threads;
+      sim -> report_progress = 0;
+      sim -> execute();
+      finished = true;
+    }
+  };
 
-        // TODO: this is the only place in the entire code base where scaling_delta_dps shows up, 
-        // apart from declaration in simulationcraft.hpp line 4535. Possible to remove?
-        p -> scaling_delta_dps[ sm ].set_stat( stat, delta_score );
+  size_t max_running = std::min( static_cast<size_t>( concurrency ), tasks.size() );
+  int free_threads = std::max( sim -> threads, 1 );
+  if ( sim -> deterministic )
+  {
+    max_running = std::min( max_running, static_cast<size_t>( std::max( 1, concurrency / free_threads ) ) );
+    free_threads = static_cast<int>( max_running ) * std::max( sim -> threads, 1 );
+  }
+  size_t next_task = 0;
+  std::vector<std::unique_ptr<sim_thread_t>> running;
+  double last_report = 0;
 
-        double score = ( delta_score - ref_score ) / divisor;
-        double error = delta_error * delta_error + ref_error * ref_error;
+  while ( next_task < tasks.size() || ! running.empty() )
+  {
+    while ( next_task < tasks.size() && running.size() < max_running &&
+            free_threads > 0 && ! sim -> is_canceled() )
+    {
+      size_t sharers = std::min( tasks.size() - next_task, max_running - running.size() );
+      int threads = std::max( 1, free_threads / static_cast<int>( sharers ) );
+      if ( sim -> deterministic )
+        threads = std::max( sim -> threads, 1 );
+      free_threads -= threads;
+
+      running.push_back( std::unique_ptr<sim_thread_t>( new sim_thread_t( tasks[ next_task ].sim, next_task, threads ) ) );
+      running.back() -> launch();
+      next_task++;
+    }
 
-        if ( error > 0 )
-          error = sqrt( error );
+    if ( sim -> is_canceled() && running.empty() )
+      break;
 
-        error = fabs( error / divisor );
+    sc_thread_t::sleep_seconds( 0.05 );
 
-        if ( fabs( divisor ) < 1.0 ) // For things like Weapon Speed, show the gain per 0.1 speed gain rather than every 1.0.
-        {
-          score /= 10.0;
-          error /= 10.0;
-          delta_error /= 10.0;
-        }
+    for ( size_t i = 0; i < running.size(); )
+    {
+      if ( ! running[ i ] -> finished )
+      {
+        ++i;
+        continue;
+      }
+
+      running[ i ] -> join();
+      free_threads += running[ i ] -> threads;
+      job_t& job = jobs[ tasks[ running[ i ] -> task ].job ];
+      running[ i ] = std::move( running.back() );
+      running.pop_back();
 
-        analyze_ability_stats( stat, divisor, p, ref_p, delta_p );
+      if ( --job.pending_sims > 0 )
+        continue;
 
-        if ( center )
-          p -> scaling_compare_error[ sm ].set_stat( stat, error );
-        else
-          p -> scaling_compare_error[ sm ].set_stat( stat, delta_error / divisor );
+      if ( ! sim -> is_canceled() )
+        analyze_stat_results( job.stat, job.scale_delta, job.center, job.ref_sim, job.delta_sim );
 
-        p -> scaling[ sm ].set_stat( stat, score );
-        p -> scaling_error[ sm ].set_stat( stat, error );
+      mutex.lock();
+      concurrent_sims.erase( std::remove( concurrent_sims.begin(), concurrent_sims.end(), job.delta_sim ), concurrent_sims.end() );
+      delete job.delta_sim;
+      job.delta_sim = nullptr;
+      completed_sims++;
+      if ( job.ref_sim != baseline_sim )
+      {
+        concurrent_sims.erase( std::remove( concurrent_sims.begin(), concurrent_sims.end(), job.ref_sim ), concurrent_sims.end() );
+        delete job.ref_sim;
+        completed_sims++;
       }
+      job.ref_sim = nullptr;
+      remaining_scaling_stats--;
+      if ( remaining_scaling_stats > 0 )
+        current_scaling_stat = stats_to_scale[ num_scaling_stats - remaining_scaling_stats ];
+      mutex.unlock();
     }
 
-    if ( debug_scale_factors )
+    if ( sim -> report_progress && util::wall_time() - last_report > 1.0 )
     {
-      std::cout << "\nref_sim report for '" << util::stat_type_string( stat ) << "'..." << std::endl;
-      report::print_text( ref_sim, true );
-      std::cout << "\ndelta_sim report for '" << util::stat_type_string( stat ) << "'..." << std::endl;
-      report::print_text( delta_sim, true );
+      last_report = util::wall_time();
+      std::string phase;
+      double pct = progress( phase );
+      util::fprintf( stdout, "Generating scale factors: %5.1f%% (%d/%d stats, %d sims running)\r",
+                     pct * 100.0, num_scaling_stats - remaining_scaling_stats, num_scaling_stats,
+                     as<int>( running.size() ) );
+      fflush( stdout );
     }
+  }
 
-    mutex.lock();
-    if ( ref_sim != baseline_sim && ref_sim != sim )
+  // Sims that were never started because the baseline sim was canceled
+  mutex.lock();
+  for ( size_t i = 0; i < jobs.size(); ++i )
+  {
+    delete jobs[ i ].delta_sim;
+    if ( jobs[ i ].ref_sim != baseline_sim )
+      delete jobs[ i ].ref_sim;
+  }
+  concurrent_sims.clear();
+  mutex.unlock();
+
+  if ( sim -> report_progress && ! sim -> is_canceled() )
+  {
+    util::fprintf( stdout, "Generating scale factors: %5.1f%% (%d/%d stats)%20s\n",
+                   100.0, num_scaling_stats, num_scaling_stats, "" );
+    fflush( stdout );
+  }
+}
+
+// scaling_t::create_delta_sim ==============================================
+
+sim_t* scaling_t::create_delta_sim( stat_e stat, double value, bool reference )
+{
+  sim_t* s = new sim_t( sim );
+
+  if ( sim -> report_progress )
+  {
+    std::stringstream stat_name; stat_name.width( reference ? 8 : 12 );
+    stat_name << std::left << std::string( util::stat_type_abbrev( stat ) ) + ":";
+    s -> sim_phase_str = ( reference ? "Generating ref " : "Generating " ) + stat_name.str();
+  }
+
+  s -> scaling -> scale_stat = stat;
+  s -> scaling -> scale_value = value;
+
+  return s;
+}
+
+// scaling_t::analyze_stat_results ==========================================
+
+void scaling_t::analyze_stat_results( stat_e stat, double scale_delta, bool center, sim_t* ref_sim, sim_t* delta_sim )
+{
+  for ( size_t j = 0; j < sim -> players_by_name.size(); j++ )
+  {
+    player_t* p = sim -> players_by_name[ j ];
+
+    if ( ! p -> scales_with[ stat ] ) continue;
+
+    player_t*   ref_p =   ref_sim -> find_player( p -> name() );
+    player_t* delta_p = delta_sim -> find_player( p -> name() );
+    assert( ref_p && "Reference Player not found" );
+    assert( delta_p && "Delta player not found" );
+
+    double divisor = scale_delta;
+
+    if ( delta_p -> invert_scaling )
+      divisor = -divisor;
+
+    if ( divisor < 0.0 ) divisor += ref_p -> over_cap[ stat ];
+
+    for ( scale_metric_e sm = SCALE_METRIC_NONE; sm < SCALE_METRIC_MAX; sm++ )
     {
-      delete ref_sim;
-      ref_sim = nullptr;
+
+      double delta_score = delta_p -> scaling_for_metric( sm ).value;
+      double   ref_score = ref_p -> scaling_for_metric( sm ).value;
+
+      double delta_error = delta_p -> scaling_for_metric( sm ).stddev * delta_sim -> confidence_estimator;
+      double   ref_error = ref_p -> scaling_for_metric( sm ).stddev * ref_sim -> confidence_estimator;
+
+      // TODO: this is the only place in the entire code base where scaling_delta_dps shows up, 
+      // apart from declaration in simulationcraft.hpp line 4535. Possible to remove?
+      p -> scaling_delta_dps[ sm ].set_stat( stat, delta_score );
+
+      double score = ( delta_score - ref_score ) / divisor;
+      double error = delta_error * delta_error + ref_error * ref_error;
+
+      if ( error > 0 )
+        error = sqrt( error );
+
+      // Common random numbers: the error of the paired difference replaces the
+      // error of two independent sims.
+      paired_samples_t paired;
+      if ( common_random_numbers && paired.pair( ref_p, delta_p, sm ) )
+      {
+        error = sqrt( paired.difference_variance() / paired.count ) * delta_sim -> confidence_estimator;
+        p -> scaling_correlation[ sm ].set_stat( stat, paired.correlation() );
+        p -> scaling_variance_reduction[ sm ].set_stat( stat, paired.variance_reduction() );
+      }
+
+      error = fabs( error / divisor );
+
+      if ( fabs( divisor ) < 1.0 ) // For things like Weapon Speed, show the gain per 0.1 speed gain rather than every 1.0.
+      {
+        score /= 10.0;
+        error /= 10.0;
+        delta_error /= 10.0;
+      }
+
+      analyze_ability_stats( stat, divisor, p, ref_p, delta_p );
+
+      if ( center )
+        p -> scaling_compare_error[ sm ].set_stat( stat, error );
+      else
+        p -> scaling_compare_error[ sm ].set_stat( stat, delta_error / divisor );
+
+      p -> scaling[ sm ].set_stat( stat, score );
+      p -> scaling_error[ sm ].set_stat( stat, error );
     }
-    delete delta_sim;  
-    delta_sim  = nullptr;
-    remaining_scaling_stats--;
-    mutex.unlock();
   }
 
-  if ( baseline_sim != sim ) delete baseline_sim;
-  baseline_sim = nullptr;
+  if ( debug_scale_factors )
+  {
+    std::cout << "\nref_sim report for '" << util::stat_type_string( stat ) << "'..." << std::endl;
+    report::print_text( ref_sim, true );
+    std::cout << "\ndelta_sim report for '" << util::stat_type_string( stat ) << "'..." << std::endl;
+    report::print_text( delta_sim, true );
+  }
 }
 
 /* Creates scale factors for stats_t objects
@@ -514,7 +839,9 @@ void scaling_t::create_options()
   sim->add_option(opt_float("scale_delta_multiplier", scale_delta_multiplier)); // multiplies all default scale deltas
   sim->add_option(opt_bool("positive_scale_delta", positive_scale_delta));
   sim->add_option(opt_bool("scale_lag", scale_lag));
+  sim->add_option(opt_int("scale_factor_concurrency", scale_factor_concurrency)); // max. delta sims run at once, 0 = one per thread
   sim->add_option(opt_float("scale_factor_noise", scale_factor_noise));
+  sim->add_option(opt_bool("common_random_numbers", common_random_numbers)); // pair ref/delta sim iterations for lower scale factor errors
   sim->add_option(opt_float("scale_strength", stats.attribute[ATTR_STRENGTH]));
   sim->add_option(opt_float("scale_agility", stats.attribute[ATTR_AGILITY]));
   sim->add_option(opt_float("scale_stamina", stats.attribute[ATTR_STAMINA]));
@@ -958,7 +958,7 @@ struct resource_timeline_collect_event_t : public event_t
   { return "resource_timeline_collect_event_t"; }
   virtual void execute()
   {
-    if ( sim().iterations == 1 || sim().current_iteration > 0 )
+    if ( sim().current_index >= 0 )
     {
       // Assumptions: Enemies do not have primary resource regeneration
       for ( size_t i = 0, actors = sim().player_non_sleeping_list.size(); i < actors; i++ )
@@ -1209,6 +1209,11 @@ struct compare_name
   }
 };
 
+// A thread claims 1/WORK_BATCH_DIVISOR of its share of the remaining work at
+// once, but never more than WORK_BATCH_MAX iterations.
+const int WORK_BATCH_DIVISOR = 4;
+const int WORK_BATCH_MAX = 64;
+
 } // UNNAMED NAMESPACE ===================================================
 
 // ==========================================================================
@@ -1228,6 +1233,7 @@ sim_t::sim_t( sim_t* p, int index ) :
   vary_combat_length( 0.0 ),
   current_iteration( -1 ),
   iterations( 0 ),
+  current_index( -1 ),
   canceled( 0 ),
   target_error( 0 ),
   current_error( 0 ),
@@ -1257,7 +1263,9 @@ sim_t::sim_t( sim_t* p, int index ) :
   travel_variance( 0 ), default_skill( 1.0 ), reaction_time( timespan_t::from_seconds( 0.5 ) ),
   regen_periodicity( timespan_t::from_seconds( 0.25 ) ),
   ignite_sampling_delta( timespan_t::from_seconds( 0.2 ) ),
-  fixed_time( false ), optimize_expressions( false ),
+  fixed_time( false ), optimize_expressions( false ), compile_expressions( false ),
+  incremental_expressions( false ), incremental_expressions_check( false ), optimize_action_lists( false ),
+  profile_cpu( 0 ),
   current_slot( -1 ),
   optimal_raid( 0 ), log( 0 ), debug_each( 0 ), save_profiles( 0 ), default_actions( 0 ),
   normalized_stat( STAT_NONE ),
@@ -1271,18 +1279,21 @@ sim_t::sim_t( sim_t* p, int index ) :
   disable_set_bonuses( false ), disable_2_set( 1 ), disable_4_set( 1 ), enable_2_set( 1 ), enable_4_set( 1 ),
   pvp_crit( false ), equalize_plot_weights( false ),
   active_enemies( 0 ), active_allies( 0 ),
-  _rng(), seed( 0 ), deterministic( false ),
+  _rng(), seed( 0 ), iteration_seed( 0 ), deterministic( false ), actor_rng_streams( false ),
   average_range( true ), average_gauss( false ),
   convergence_scale( 2 ),
   fight_style( "Patchwerk" ), overrides( overrides_t() ), auras( auras_t() ),
   default_aura_delay( timespan_t::from_millis( 30 ) ),
   default_aura_delay_stddev( timespan_t::from_millis( 5 ) ),
   progress_bar( *this ),
+  iteration_design( *this ),
   scaling( new scaling_t( this ) ),
   plot( new plot_t( this ) ),
   reforge_plot( new reforge_plot_t( this ) ),
   elapsed_cpu( 0.0 ),
   elapsed_time( 0.0 ),
+  elapsed_merge_time( 0.0 ),
+  iteration_end_time( 0.0 ),
   iteration_dmg( 0 ), priority_iteration_dmg( 0 ), iteration_heal( 0 ), iteration_absorb( 0 ),
   raid_dps(), total_dmg(), raid_hps(), total_heal(), total_absorb(), raid_aps(),
   simulation_length( "Simulation Length", false ),
@@ -1292,7 +1303,7 @@ sim_t::sim_t( sim_t* p, int index ) :
   // Report
   report_precision(2), report_pets_separately( 0 ), report_targets( 1 ), report_details( 1 ), report_raw_abilities( 1 ),
   report_rng( 0 ), hosted_html( 0 ),
-  save_raid_summary( 0 ), save_gear_comments( 0 ), statistics_level( 1 ), separate_stats_by_actions( 0 ), report_raid_summary( 0 ), buff_uptime_timeline( 0 ),
+  save_raid_summary( 0 ), save_gear_comments( 0 ), statistics_level( 1 ), quantile_sketch_str(), quantile_sketch_accuracy( 0.005 ), separate_stats_by_actions( 0 ), report_raid_summary( 0 ), buff_uptime_timeline( 0 ),
   wowhead_tooltips( -1 ),
   allow_potions( true ),
   allow_food( true ),
@@ -1303,12 +1314,14 @@ sim_t::sim_t( sim_t* p, int index ) :
   apikey( get_api_key() ),
   ilevel_raid_report( false ),
   distance_targeting_enabled( false ),
+  spatial_index( *this ),
   enable_dps_healing( false ),
   scaling_normalized( 1.0 ),
   report_information(),
   // Multi-Threading
   threads( 0 ), thread_index( index ), process_priority( computer_process::BELOW_NORMAL ),
   work_queue( new work_queue_t() ),
+  convergence( new convergence_monitor_t() ),
   spell_query(), spell_query_level( MAX_LEVEL ),
   pause_mutex( nullptr ),
   paused( false ),
@@ -1345,7 +1358,7 @@ sim_t::sim_t( sim_t* p, int index ) :
     // Inherit 'plot' settings from parent because are set outside of the config file
     enchant = parent -> enchant;
 
-    // While we inherit the parent seed, it may get overwritten in sim_t::init
+    // Inherit the parent seed, chosen in the parent's sim_t::setup
     seed = parent -> seed;
 
     parent -> add_relative( this );
@@ -1361,18 +1374,42 @@ sim_t::~sim_t()
     parent -> remove_relative( this );
 }
 
+// sim_t::work_queue_t::claim ===============================================
+
+int sim_t::work_queue_t::claim( int workers, int& start )
+{
+  start = work.load();
+  int total, end;
+  do
+  {
+    total = total_work.load();
+    if ( start >= total )
+      return 0;
+
+    int batch = ( total - start ) / ( std::max( workers, 1 ) * WORK_BATCH_DIVISOR );
+    end = start + clamp( batch, 1, WORK_BATCH_MAX );
+    if ( end > total )
+      end = total;
+  } while ( ! work.compare_exchange_weak( start, end ) );
+
+  if ( end == total )
+    projected_work = total;
+
+  return end - start;
+}
+
 // sim_t::iteration_time_adjust =============================================
 
 double sim_t::iteration_time_adjust() const
 {
-  if ( iterations <= 1 )
-    return 1.0;
+  return iteration_design.time_adjust();
+}
 
-  if ( current_iteration == 0 )
-    return 1.0;
+// sim_t::iteration_health_adjust ===========================================
 
-  auto progress = work_queue -> progress();
-  return 1.0 + vary_combat_length * ( ( current_iteration % 2 ) ? 1 : -1 ) * progress.pct();
+double sim_t::iteration_health_adjust() const
+{
+  return iteration_design.health_adjust();
 }
 
 // sim_t::expected_max_time =================================================
@@ -1491,11 +1528,10 @@ void sim_t::reset()
   if ( debug )
     out_debug << "Resetting Simulator";
 
-  if( deterministic )
-    seed = rng().reseed();
-
   event_mgr.reset();
 
+  spatial_index.clear();
+
   expected_iteration_time = max_time * iteration_time_adjust();
 
   for ( auto& buff : buff_list )
@@ -1514,6 +1550,18 @@ void sim_t::reset()
     }
   }
 
+  // Every action has optimized its conditions on its own, see action_t::reset
+  if ( current_iteration == 1 )
+  {
+    for ( auto& actor : actor_list )
+      expr_t::optimize_action_list( *actor );
+  }
+  else if ( current_iteration == 2 )
+  {
+    for ( auto& actor : actor_list )
+      expr_t::report_action_list( *actor );
+  }
+
   raid_event_t::reset( this );
 }
 
@@ -1646,8 +1694,11 @@ void sim_t::combat_end()
     b -> expire();
   }
 
-  if ( iterations == 1 || current_iteration >= 1 )
+  if ( current_index >= 0 )
+  {
     datacollection_end();
+    work_queue -> complete();
+  }
 
   assert( active_enemies == 0 );
   assert( active_allies == 0 );
@@ -1723,10 +1774,10 @@ void sim_t::datacollection_end()
   total_absorb.add( iteration_absorb );
   raid_aps.add( current_time() != timespan_t::zero() ? iteration_absorb / current_time().total_seconds() : 0 );
 
-  if ( deterministic && report_iteration_data > 0 && current_iteration > 0 && current_time() > timespan_t::zero() )
+  if ( deterministic && report_iteration_data > 0 && current_index >= 0 && current_time() > timespan_t::zero() )
   {
     // TODO: Metric should be selectable
-    iteration_data_entry_t entry( iteration_dmg / current_time().total_seconds(), seed );
+    iteration_data_entry_t entry( iteration_dmg / current_time().total_seconds(), iteration_seed );
     for ( size_t i = 0, end = target_list.size(); i < end; ++i )
     {
       const player_t* t = target_list[ i ];
@@ -1741,10 +1792,10 @@ void sim_t::datacollection_end()
     }
 
     if ( std::find_if( iteration_data.begin(), iteration_data.end(),
-                       seed_predicate_t( seed ) ) != iteration_data.end() )
+                       seed_predicate_t( iteration_seed ) ) != iteration_data.end() )
     {
       errorf( "[Thread-%d] Duplicate seed %llu found on iteration %u, skipping ...",
-          thread_index, seed, current_iteration );
+          thread_index, iteration_seed, current_index );
     }
     else
     {
@@ -1753,37 +1804,110 @@ void sim_t::datacollection_end()
   }
 }
 
+// sim_t::convergence_monitor_t::publish ===================================
+
+void sim_t::convergence_monitor_t::publish( int thread, const std::vector<player_t*>& actors )
+{
+  if ( thread >= static_cast<int>( slots.size() ) )
+    return;
+
+  slot_t& slot = slots[ thread ];
+
+  // Only the owning thread writes the slot, so allocating on first use is safe
+  if ( slot.size.load( std::memory_order_relaxed ) == 0 )
+  {
+    slot.data.reset( new moments_t[ actors.size() ] );
+    slot.size.store( actors.size(), std::memory_order_release );
+  }
+
+  unsigned sequence = slot.sequence.load( std::memory_order_relaxed );
+  slot.sequence.store( sequence + 1, std::memory_order_relaxed ); // odd: update in progress
+  std::atomic_thread_fence( std::memory_order_release );
+
+  for ( size_t i = 0, end = std::min( actors.size(), slot.size.load( std::memory_order_relaxed ) ); i < end; ++i )
+  {
+    const simple_sample_data_t& metric = actors[ i ] -> collected_data.target_metric;
+    moments_t& m = slot.data[ i ];
+    m.sum.store( metric.sum(), std::memory_order_relaxed );
+    m.running_mean.store( metric.running_mean(), std::memory_order_relaxed );
+    m.m2.store( metric.m2(), std::memory_order_relaxed );
+    m.count.store( metric.count(), std::memory_order_relaxed );
+  }
+
+  slot.sequence.store( sequence + 2, std::memory_order_release );
+}
+
+// sim_t::convergence_monitor_t::pooled ====================================
+
+simple_sample_data_t sim_t::convergence_monitor_t::pooled( size_t actor ) const
+{
+  simple_sample_data_t result;
+
+  for ( const auto& slot : slots )
+  {
+    if ( actor >= slot.size.load( std::memory_order_acquire ) )
+      continue;
+
+    // The moments are atomics, so reading them while the owner republishes is
+    // not a data race; the sequence counter only rejects mixed copies.
+    const moments_t& m = slot.data[ actor ];
+    simple_sample_data_t copy;
+    unsigned before, after;
+    do
+    {
+      before = slot.sequence.load( std::memory_order_acquire );
+      copy = simple_sample_data_t( m.sum.load( std::memory_order_relaxed ),
+                                   m.count.load( std::memory_order_relaxed ),
+                                   m.running_mean.load( std::memory_order_relaxed ),
+                                   m.m2.load( std::memory_order_relaxed ) );
+      std::atomic_thread_fence( std::memory_order_acquire );
+      after = slot.sequence.load( std::memory_order_relaxed );
+    } while ( ( before & 1 ) || before != after );
+
+    result.merge( copy );
+  }
+
+  return result;
+}
+
 // sim_t::analyze_error =====================================================
 
+/* Every thread publishes its target metric statistics when it finishes a
+ * batch of iterations from the work queue ( or every analyze_error_interval
+ * iterations ), and checks the error of the statistics pooled over all
+ * threads. The first thread to see the error below target_error stops the
+ * simulation for everyone by flushing the shared work queue.
+ */
 void sim_t::analyze_error()
 {
-  if ( thread_index != 0 ) return;
   if ( target_error <= 0 ) return;
   if ( current_iteration < 1 ) return;
-  if ( current_iteration % analyze_error_interval != 0 ) return;
+  if ( work_batch.remaining > 0 && current_iteration % analyze_error_interval != 0 ) return;
+  if ( convergence -> converged ) return;
+
+  convergence -> publish( thread_index, actor_list );
 
   double mean_total=0;
   int mean_count=0;
+  size_t pooled_iterations = 0;
 
-  current_error = 0;
+  double error = 0;
 
   for ( size_t i = 0; i < actor_list.size(); i++ )
   {
-    player_t* p = actor_list[i];
-    player_collected_data_t& cd = p -> collected_data;
-    AUTO_LOCK( cd.target_metric_mutex );
-    if ( cd.target_metric.size() != 0 )
+    simple_sample_data_t pooled = convergence -> pooled( i );
+    if ( pooled.count() < 2 )
+      continue;
+
+    double mean = pooled.mean();
+    if ( mean != 0 )
     {
-      cd.target_metric.analyze_basics();
-      cd.target_metric.analyze_variance();
-      double mean = cd.target_metric.mean();
-      if ( mean != 0 )
-      {
-        double error = sim_t::distribution_mean_error( *this, cd.target_metric ) / mean;
-        if ( error > current_error ) current_error = error;
-        mean_total += mean;
-        mean_count++;
-      }
+      double mean_std_dev = std::sqrt( pooled.online_variance() / pooled.count() );
+      double actor_error = confidence_estimator * mean_std_dev / mean;
+      if ( actor_error > error ) error = actor_error;
+      mean_total += mean;
+      mean_count++;
+      pooled_iterations = std::max( pooled_iterations, pooled.count() );
     }
   }
 
@@ -1792,19 +1916,27 @@ void sim_t::analyze_error()
     current_mean = mean_total / mean_count;
   }
 
-  current_error *= 100;
+  current_error = error * 100;
 
-  if ( current_error > 0 )
+  // Do not trust the error estimate of a handful of iterations
+  if ( current_error > 0 && pooled_iterations >= static_cast<size_t>( analyze_error_interval ) )
   {
     if ( current_error < target_error )
     {
-      interrupt();
+      if ( ! convergence -> converged.exchange( true ) )
+      {
+        auto progress = work_queue -> progress();
+        convergence -> converged_iterations = progress.current_iterations;
+        convergence -> iterations_saved = std::max( 0, work_queue -> size() - progress.current_iterations );
+        work_queue -> flush();
+      }
     }
     else
     {
       auto progress = work_queue -> progress();
-      work_queue -> project( static_cast<int>( progress.current_iterations * ( ( current_error * current_error ) /
-        ( target_error *  target_error ) ) ) );
+      int projection = static_cast<int>( progress.current_iterations * ( ( current_error * current_error ) /
+        ( target_error *  target_error ) ) );
+      work_queue -> project( projection );
     }
   }
 }
@@ -2082,19 +2214,7 @@ bool sim_t::init()
 
   unique_gear::register_target_data_initializers( this );
 
-  // Seed RNG
-  if ( seed == 0 )
-  {
-    if( deterministic )
-    {
-      seed = 31459;
-    }
-    else
-    {
-      std::random_device rd;
-      seed  = uint64_t(rd()) | (uint64_t(rd()) << 32);
-    }
-  }
+  // Seed RNG, the seed itself is chosen in sim_t::setup
   _rng = rng::create( rng::parse_type( rng_str ) );
   _rng -> seed( seed + thread_index );
 
@@ -2250,6 +2370,12 @@ bool sim_t::init()
   // Initialize actors
   if ( ! init_actors() ) return false;
 
+  if ( actor_rng_streams )
+  {
+    for ( auto& actor : actor_list )
+      actor -> actor_rng = rng::create( rng::parse_type( rng_str ) );
+  }
+
   if ( report_precision < 0 ) report_precision = 2;
 
   simulation_length.reserve( std::min( iterations, 10000 ) );
@@ -2357,9 +2483,40 @@ bool sim_t::iterate()
 
   progress_bar.init();
 
-  do
+  // A thread with more than one iteration to run starts with a warm-up
+  // iteration. It has no index in the work queue and its data is not
+  // collected. Every other iteration is claimed from the queue before it runs.
+  bool warm_up = iterations > 1;
+
+  while ( warm_up || work_queue -> pop( work_batch, threads ) )
   {
     ++current_iteration;
+    current_index = warm_up ? -1 : work_batch.index;
+    warm_up = false;
+
+    if ( deterministic )
+    {
+      // Streams only depend on the sim seed and the iteration index, so it
+      // does not matter which thread runs the iteration. The first iteration
+      // uses the sim seed itself, so any iteration can be rerun on its own by
+      // using its iteration seed as the sim seed. Warm-up iterations use a
+      // stream of their own, so every thread warms up the same way.
+      uint64_t index = std::max( current_index, 0 );
+      uint64_t stream = current_index < 0 ? 1 : 0;
+      iteration_seed = rng::stream_seed( seed, index, 0, stream );
+      rng().seed_stream( seed, index, 0, stream );
+      rng().reset();
+
+      // Per actor streams keep one actor's random numbers independent of how
+      // many the other actors consumed in this iteration.
+      for ( auto& actor : actor_list )
+      {
+        if ( ! actor -> actor_rng )
+          continue;
+        actor -> actor_rng -> seed_stream( seed, index, actor -> actor_index + 1, stream );
+        actor -> actor_rng -> reset();
+      }
+    }
 
     combat();
 
@@ -2370,8 +2527,7 @@ bool sim_t::iterate()
     }
 
     do_pause();
-
-  } while( work_queue -> pop() );
+  }
 
   if ( ! canceled && progress_bar.update( true ) )
   {
@@ -2383,7 +2539,9 @@ bool sim_t::iterate()
 
   iterations = current_iteration + 1;
 
-  return iterations > 0;
+  // A thread without a warm-up iteration may find the queue drained by the
+  // other threads before running any iteration of its own.
+  return true;
 }
 
 /**
@@ -2414,8 +2572,6 @@ void sim_t::do_pause()
 /// merge sims
 void sim_t::merge( sim_t& other_sim )
 {
-  auto_lock_t auto_lock( merge_mutex );
-
   iterations += other_sim.iterations;
 
   simulation_length.merge( other_sim.simulation_length );
@@ -2445,13 +2601,47 @@ void sim_t::merge( sim_t& other_sim )
   range::append( iteration_data, other_sim.iteration_data );
 }
 
+/* Merge the sims of the subtree rooted at this thread into this sim.
+ *
+ * Threads form a binomial tree over their thread index: in round r, every
+ * thread whose index is a multiple of 2^(r+1) merges in thread index + 2^r,
+ * once that thread has merged its own subtree. Independent merges run in
+ * parallel on the threads that finished iterating, so the whole reduction
+ * takes log2( threads ) rounds instead of threads - 1 serial merges into the
+ * main sim. The merge order is fixed by the thread indices, not by the order
+ * in which threads finish.
+ */
+void sim_t::merge_tree()
+{
+  // Thread 0 owns the other threads. It may still have a parent of its own,
+  // like the reference and delta sims of scale factors, plots and reforge
+  // plots.
+  sim_t* root = thread_index == 0 ? this : parent;
+  int num_threads = as<int>( root -> children.size() ) + 1;
+
+  for ( int step = 1; thread_index + step < num_threads; step *= 2 )
+  {
+    if ( thread_index & step )
+      break;
+
+    sim_t* child = root -> children[ thread_index + step - 1 ];
+    child -> join();
+
+    iteration_end_time = std::max( iteration_end_time, child -> iteration_end_time );
+    if ( initialized && child -> iterations > 0 )
+      merge( *child );
+  }
+}
+
 /// merge all sims together
 void sim_t::merge()
 {
   if ( children.empty() )
     return;
 
-  merge_mutex.unlock();
+  merge_tree();
+
+  elapsed_merge_time = std::max( 0.0, util::wall_time() - iteration_end_time );
 
   for ( size_t i = 0; i < children.size(); i++ )
   {
@@ -2471,10 +2661,12 @@ void sim_t::merge()
 
 void sim_t::run()
 {
-  if( iterate() )
-  {
-    parent -> merge( *this );
-  }
+  if ( ! iterate() )
+    iterations = 0; // Nothing to merge
+
+  iteration_end_time = util::wall_time();
+
+  merge_tree();
 }
 
 // sim_t::partition =========================================================
@@ -2485,22 +2677,15 @@ void sim_t::partition()
 
   if ( threads <= 1 )
     return;
-  if ( iterations < threads )
+  // Every thread of a deterministic sim needs a warm-up iteration, see iterate()
+  if ( iterations < ( deterministic ? 2 : 1 ) * threads )
     return;
 
-  merge_mutex.lock(); // parent sim is locked until parent merge() is called
-
   int remainder = iterations % threads;
   iterations /= threads;
 
-  // Normally we use a shared work-queue to ensure proper load balancing among threads.
-  // However, when we desire deterministic runs (for debugging) we need to force the
-  // sims to each use a specific number of iterations as opposed to using shared pool of work.
-
-  if( deterministic ) 
-  {
-    work_queue -> init( iterations );
-  }
+  // All threads share the work queue to ensure proper load balancing among threads. This
+  // includes deterministic runs, which seed each iteration from its index in the queue.
 
   int num_children = threads - 1;
 
@@ -2517,14 +2702,8 @@ void sim_t::partition()
       remainder--;
     }
 
-    if( deterministic ) 
-    {
-      child -> work_queue -> init( child -> iterations );
-    }
-    else // share the work queue
-    {
-      child -> work_queue = work_queue;
-    }
+    child -> work_queue = work_queue;
+    child -> convergence = convergence;
     child -> report_progress = 0;
   }
 
@@ -2543,6 +2722,7 @@ bool sim_t::execute()
 
   partition();
   bool success = iterate();
+  iteration_end_time = util::wall_time();
   merge(); // Always merge, even in cases of unsuccessful simulation!
   if( success )
     analyze();
@@ -2758,6 +2938,11 @@ void sim_t::create_options()
   add_option( opt_int( "stat_cache", stat_cache ) );
   add_option( opt_int( "max_aoe_enemies", max_aoe_enemies ) );
   add_option( opt_bool( "optimize_expressions", optimize_expressions ) );
+  add_option( opt_bool( "compile_expressions", compile_expressions ) );
+  add_option( opt_bool( "incremental_expressions", incremental_expressions ) );
+  add_option( opt_bool( "incremental_expressions_check", incremental_expressions_check ) );
+  add_option( opt_bool( "optimize_action_lists", optimize_action_lists ) ); // condition time per evaluation before/after needs profile_cpu > 0
+  add_option( opt_int( "profile_cpu", profile_cpu ) ); // time one in N calls of each action part, 0 = off
   // Raid buff overrides
   add_option( opt_func( "optimal_raid", parse_optimal_raid ) );
   add_option( opt_int( "override.attack_power_multiplier", overrides.attack_power_multiplier ) );
@@ -2819,6 +3004,8 @@ void sim_t::create_options()
   // RNG
   add_option( opt_string( "rng", rng_str ) );
   add_option( opt_bool( "deterministic", deterministic ) );
+  add_option( opt_string( "iteration_design", iteration_design.design_str ) );
+  add_option( opt_int( "iteration_design_strata", iteration_design.strata ) );
   add_option( opt_float( "report_iteration_data", report_iteration_data ) );
   add_option( opt_int( "min_report_iteration_data", min_report_iteration_data ) );
   add_option( opt_bool( "average_range", average_range ) );
@@ -2831,6 +3018,7 @@ void sim_t::create_options()
   add_option( opt_float( "wheel_granularity", event_mgr.wheel_granularity ) );
   add_option( opt_int( "wheel_seconds", event_mgr.wheel_seconds ) );
   add_option( opt_int( "wheel_shift", event_mgr.wheel_shift ) );
+  add_option( opt_bool( "wheel_overflow", event_mgr.wheel_overflow ) );
   add_option( opt_string( "reference_player", reference_player_str ) );
   add_option( opt_string( "raid_events", raid_events_str ) );
   add_option( opt_append( "raid_events+", raid_events_str ) );
@@ -2918,6 +3106,8 @@ void sim_t::create_options()
   add_option( opt_bool( "report_raw_abilities", report_raw_abilities ) );
   add_option( opt_bool( "report_rng", report_rng ) );
   add_option( opt_int( "statistics_level", statistics_level ) );
+  add_option( opt_string( "quantile_sketch", quantile_sketch_str ) );
+  add_option( opt_float( "quantile_sketch_accuracy", quantile_sketch_accuracy ) );
   add_option( opt_bool( "separate_stats_by_actions", separate_stats_by_actions ) );
   add_option( opt_bool( "report_raid_summary", report_raid_summary ) ); // Force reporting of raid summary
   add_option( opt_string( "reforge_plot_output_file", reforge_plot_output_file_str ) );
@@ -2977,6 +3167,21 @@ void sim_t::setup( sim_control_t* c )
     }
   }
 
+  // Choose the seed before any child sim is created, so all threads and
+  // related sims inherit it ( the iteration design depends on it ).
+  if ( ! parent && seed == 0 )
+  {
+    if( deterministic )
+    {
+      seed = 31459;
+    }
+    else
+    {
+      std::random_device rd;
+      seed  = uint64_t(rd()) | (uint64_t(rd()) << 32);
+    }
+  }
+
   // Combat
   // Try very hard to limit this to just what would be displayed on the gui.
   // Super-users can use misc options.
@@ -3056,6 +3261,22 @@ void sim_t::setup( sim_control_t* c )
     threads = 1;
   }
 
+  // Common random numbers pair the iterations of the scaling sims by index,
+  // which needs the deterministic per iteration seeding and a fixed iteration count.
+  if ( scaling -> common_random_numbers && scaling -> calculate_scale_factors )
+  {
+    if ( iterations <= 0 || target_error > 0 )
+    {
+      errorf( "common_random_numbers=1 requires a fixed number of iterations and no target_error, disabling.\n" );
+      scaling -> common_random_numbers = 0;
+    }
+    else
+    {
+      deterministic = 1;
+      actor_rng_streams = true;
+    }
+  }
+
   if ( iterations <= 0 )
   {
     iterations = 1000000; // limited by relative standard error
@@ -3088,6 +3309,13 @@ void sim_t::setup( sim_control_t* c )
   }
 
   work_queue -> init( iterations );
+  if ( ! iteration_design.init() )
+  {
+    std::stringstream s;
+    s << "Invalid iteration_design '" << iteration_design.design_str << "'";
+    throw std::invalid_argument( s.str() );
+  }
+  convergence -> init( std::max( 1, threads ) );
 
   if( deterministic && ( target_error != 0 ) )
   {
@@ -3101,20 +3329,6 @@ sim_t::sim_progress_t sim_t::progress( std::string* detailed )
 {
   auto progress = work_queue -> progress();
 
-  if ( deterministic )
-  {
-    AUTO_LOCK( relatives_mutex );
-    for ( const auto& child : children )
-    {
-      if ( child )
-      {
-        auto progress = child -> work_queue -> progress();
-        progress.current_iterations += progress.current_iterations;
-        progress.total_iterations += progress.total_iterations;
-      }
-    }
-  }
-
   detailed_progress( detailed, progress.current_iterations, progress.total_iterations );
 
   return progress;
@@ -51,6 +51,7 @@
 #include <unordered_map>
 #include <atomic>
 #include <random>
+#include <chrono>
 #if defined( SC_OSX )
 #include <Availability.h>
 #endif
@@ -138,6 +139,7 @@ struct sc_timeline_t : public timeline_t
 {
   typedef timeline_t base_t;
   using timeline_t::add;
+  using timeline_t::reserve;
   double bin_size;
 
   sc_timeline_t() : timeline_t(), bin_size( 1.0 ) {}
@@ -156,6 +158,10 @@ struct sc_timeline_t : public timeline_t
   void add( timespan_t current_time, double value )
   { base_t::add( static_cast<size_t>( current_time.total_millis() / 1000 / bin_size ), value ); }
 
+  // Preallocate storage for all bins up to max_time
+  void reserve( timespan_t max_time )
+  { base_t::reserve( static_cast<size_t>( max_time.total_millis() / 1000 / bin_size ) + 1 ); }
+
   // Add 'value' at corresponding time, replacing existing entry if new value is larger
   void add_max( timespan_t current_time, double new_value )
   {
@@ -768,6 +774,7 @@ public:
   // dynamic values
   double current_value;
   int current_stack;
+  uint64_t version; // bumped on every stack or expiration change, see expr_t::track
   timespan_t buff_duration;
   double default_chance;
   std::vector<timespan_t> stack_occurrence, stack_react_time;
@@ -1067,6 +1074,37 @@ struct expression_t
 
 // Action expression types ==================================================
 
+// Memory an expression reads directly, so compiled expressions can load it
+// without calling the expression ( see expr_t::compile ). Optionally compared
+// against a constant, eg. buff.x.up is current_stack > 0.
+struct expr_slot_t
+{
+  enum slot_e { SLOT_DOUBLE, SLOT_INT, SLOT_UNSIGNED, SLOT_BOOL, SLOT_TIMESPAN };
+
+  slot_e type;
+  const void* address;
+  token_e compare;
+  double operand;
+
+  expr_slot_t() : type( SLOT_DOUBLE ), address( nullptr ), compare( TOK_UNKNOWN ), operand( 0 ) {}
+
+  bool set( const double& t )     { type = SLOT_DOUBLE;   address = &t; return true; }
+  bool set( const int& t )        { type = SLOT_INT;      address = &t; return true; }
+  bool set( const unsigned& t )   { type = SLOT_UNSIGNED; address = &t; return true; }
+  bool set( const bool& t )       { type = SLOT_BOOL;     address = &t; return true; }
+  bool set( const timespan_t& t ) { type = SLOT_TIMESPAN; address = &t; return true; }
+  template <typename T> bool set( const T& ) { return false; }
+};
+
+// Inputs of an expression, its value can be reused as long as none of them
+// changed ( see expr_t::track ).
+struct expr_deps_t
+{
+  std::vector<expr_slot_t> values;       // memory, compared by value
+  std::vector<const uint64_t*> versions; // counters bumped on every mutation
+  std::vector<const timespan_t*> times;  // the value flips when the sim reaches these times
+};
+
 struct expr_t
 {
   expr_t( const std::string& name, token_e op=TOK_UNKNOWN ) : name_( name ), op_( op ) { id_=get_global_id(); }
@@ -1079,6 +1117,10 @@ struct expr_t
 
   static expr_t* parse( action_t*, const std::string& expr_str, bool optimize=false );
   static expr_t* create_constant( const std::string& name, double value );
+  static expr_t* compile( expr_t* );
+  static expr_t* track( expr_t*, sim_t&, action_t* = nullptr );
+  static void optimize_action_list( player_t& );
+  static void report_action_list( player_t& );
 
   template <typename T> static double coerce( T t ) { return static_cast<double>( t ); }
   static double coerce( timespan_t t ) { return t.total_seconds(); }
@@ -1087,6 +1129,24 @@ struct expr_t
   virtual double evaluate() = 0;
 
   virtual bool is_constant( double* /*return_value*/ ) { return false; }
+  virtual bool slot( expr_slot_t& /* slot */ ) { return false; }
+  // Smallest and largest value the expression can take, false if unknown
+  virtual bool range( double& min, double& max )
+  {
+    double v;
+    if ( ! is_constant( &v ) ) return false;
+    min = max = v;
+    return true;
+  }
+  // Collect the inputs of the expression, false if they are not all known.
+  // The value may only depend on these ( and the sim time ).
+  virtual bool dependencies( expr_deps_t& deps )
+  {
+    expr_slot_t s;
+    if ( ! slot( s ) ) return false;
+    deps.values.push_back( s );
+    return true;
+  }
   bool always_true()  { double v; return is_constant( &v ) && v != 0.0; }
   bool always_false() { double v; return is_constant( &v ) && v == 0.0; }
 
@@ -1114,6 +1174,7 @@ public:
 private:
   const T& t;
   virtual double evaluate() { return coerce( t ); }
+  virtual bool slot( expr_slot_t& s ) { return s.set( t ); }
 
 };
 
@@ -1287,6 +1348,74 @@ struct progress_bar_t
   bool update( bool finished = false );
 };
 
+// Iteration Design =========================================================
+
+/* Chooses the fight length and target health multipliers of an iteration
+ * from its index in the work queue, instead of the thread's iteration count,
+ * so vary_combat_length is covered the same way however the iterations are
+ * spread over the threads.
+ *
+ * - sweep: alternating +/- deviation growing with the progress of the sim ( default )
+ * - stratified: every consecutive block of 'strata' iterations draws one length
+ *   from each of 'strata' equally sized length ranges, in a random order
+ * - antithetic: stratified pairs of iterations, the second one mirrors the
+ *   deviation of the first
+ * - latin_hypercube: stratified, with length and target health drawn
+ *   independently, both covering all of their strata in every block
+ */
+struct iteration_design_t
+{
+  enum design_e { DESIGN_SWEEP, DESIGN_STRATIFIED, DESIGN_ANTITHETIC, DESIGN_LATIN_HYPERCUBE };
+
+  sim_t& sim;
+  std::string design_str;
+  design_e design;
+  int strata;
+
+  iteration_design_t( sim_t& s );
+  bool init();
+  double time_adjust() const;
+  double health_adjust() const;
+private:
+  double adjust( unsigned dimension ) const;
+  double sample( int index, unsigned dimension ) const;
+  int permute( int slot, int n, uint64_t bits ) const;
+
+  mutable std::vector<int> order; // Scratch buffer of permute()
+};
+
+/* Uniform grid of the positions of the active actors, used by distance
+ * targeting to find the actors in an area without measuring the distance to
+ * every one of them. Maintained on arise, demise and player_t::set_position.
+ */
+struct spatial_index_t
+{
+  sim_t& sim;
+  double cell_size;
+
+  spatial_index_t( sim_t& s );
+  void clear();
+  void insert( player_t& );
+  void remove( player_t& );
+  void update( player_t& );
+  size_t query( double x, double y, double radius, std::vector<player_t*>* out = nullptr );
+  bool hit( player_t& ) const;
+private:
+  static const uint64_t NO_CELL = ~uint64_t( 0 );
+
+  std::unordered_map<uint64_t, std::vector<player_t*> > cells;
+  std::vector<uint64_t> actor_cell; // By actor index
+  std::vector<unsigned> actor_stamp; // By actor index, query_stamp if hit by the last query
+  unsigned query_stamp;
+  double query_x, query_y, query_radius;
+
+  int32_t cell( double v ) const
+  { return static_cast<int32_t>( std::floor( v / cell_size ) ); }
+  static uint64_t cell_key( int32_t cx, int32_t cy )
+  { return ( static_cast<uint64_t>( static_cast<uint32_t>( cx ) ) << 32 ) | static_cast<uint32_t>( cy ); }
+  void grow( const player_t& );
+};
+
 /* Encapsulated Vector
  * const read access
  * Modifying the vector triggers registered callbacks
@@ -1436,6 +1565,37 @@ struct sim_report_information_t
 
 struct event_manager_t
 {
+  // Time-ordered event list of a timing wheel slice. The tail pointer makes the
+  // common case of scheduling behind everything already in the slice O(1).
+  struct wheel_slice_t
+  {
+    event_t* head;
+    event_t* tail;
+    wheel_slice_t() : head( nullptr ), tail( nullptr ) {}
+  };
+
+  // Event memory is carved out of slabs in power-of-two size classes. Each chunk
+  // starts with a header linking it into either the free list of its size class
+  // or the list of live events, so flush() only touches events still alive.
+  struct event_chunk_t
+  {
+    event_chunk_t* prev;
+    event_chunk_t* next;
+    unsigned size_class;
+  };
+
+  struct event_size_class_t
+  {
+    std::size_t chunk_size;
+    event_chunk_t* free_list;
+    std::vector<void*> slabs;
+    unsigned live, peak_live, n_chunks;
+
+    event_size_class_t( std::size_t size ) :
+      chunk_size( size ), free_list( nullptr ), live( 0 ), peak_live( 0 ), n_chunks( 0 )
+    {}
+  };
+
   sim_t* sim;
   timespan_t current_time;
   uint64_t events_remaining;
@@ -1443,19 +1603,37 @@ struct event_manager_t
   uint64_t total_events_processed;
   uint64_t max_events_remaining;
   unsigned timing_slice, global_event_id;
-  std::vector<event_t*> timing_wheel;
-  event_t* recycled_event_list;
+  std::vector<wheel_slice_t> timing_wheel;
+  // Two-level occupancy index over timing_wheel: one bit per non-empty slice,
+  // and one summary bit per non-zero 64-slice occupancy word.
+  std::vector<uint64_t> wheel_occupancy, wheel_occupancy_summary;
+  std::vector<event_size_class_t> event_size_classes;
+  event_chunk_t live_events;
   int    wheel_seconds, wheel_size, wheel_mask, wheel_shift;
   double wheel_granularity;
   timespan_t wheel_time;
-  std::vector<event_t*> allocated_events;
+  // Overflow tier: events scheduled further than wheel_time into the future are
+  // kept in a (time, id) min-heap and cascaded into the wheel exactly once, when
+  // they come within the wheel horizon. Disabling it restores the legacy
+  // clamp-and-reschedule behavior.
+  bool wheel_overflow;
+  std::vector<event_t*> overflow_events;
+  // Canceled events are unlinked from the wheel right away, but their memory
+  // is only reclaimed once the clock moves on, so a second cancel through a
+  // stale handle in the same instant cannot hit a reused chunk.
+  std::vector<event_t*> canceled_events;
+  // Canceled events unlinked from the wheel right away, versus canceled events
+  // only flagged and skipped once they come up (executing, or in the overflow
+  // tier), versus events actually executed.
+  uint64_t total_events_canceled, total_tombstones_processed, total_events_executed;
   stopwatch_t event_stopwatch;
   bool monitor_cpu;
   bool canceled;
 
 #ifdef EVENT_QUEUE_DEBUG
   unsigned max_queue_depth, n_allocated_events, n_end_insert, n_requested_events;
-  uint64_t events_traversed, events_added;
+  uint64_t events_traversed, events_added, events_cascaded;
+  uint64_t slices_visited, slices_skipped;
   std::vector<std::pair<unsigned, unsigned> > event_queue_depth_samples;
   std::vector<unsigned> event_requested_size_count;
 #endif /* EVENT_QUEUE_DEBUG */
@@ -1466,6 +1644,13 @@ struct event_manager_t
   void recycle_event( event_t* );
   void add_event( event_t*, timespan_t delta_time );
   void reschedule_event( event_t* );
+  void wheel_insert( event_t* );
+  void insert_sorted( wheel_slice_t&, event_t* );
+  void wheel_remove( event_t* );
+  void cancel_event( event_t* );
+  void reclaim_canceled_events();
+  void cascade_overflow();
+  unsigned next_occupied_slice( unsigned from ) const;
   event_t* next_event();
   bool execute();
   void cancel();
@@ -1491,6 +1676,7 @@ struct sim_t : private sc_thread_t
   timespan_t max_time, expected_iteration_time;
   double vary_combat_length;
   int current_iteration, iterations;
+  int current_index; // Work queue index of the running iteration, -1 for warm-up iterations
   bool canceled;
   double target_error;
   double current_error;
@@ -1528,7 +1714,10 @@ struct sim_t : private sc_thread_t
   double      travel_variance, default_skill;
   timespan_t  reaction_time, regen_periodicity;
   timespan_t  ignite_sampling_delta;
-  bool        fixed_time, optimize_expressions;
+  bool        fixed_time, optimize_expressions, compile_expressions;
+  bool        incremental_expressions, incremental_expressions_check;
+  bool        optimize_action_lists;
+  int         profile_cpu;
   int         current_slot;
   int         optimal_raid, log, debug_each;
   int         save_profiles, default_actions;
@@ -1585,8 +1774,9 @@ struct sim_t : private sc_thread_t
   // Random Number Generation
   std::unique_ptr<rng::rng_t> _rng;
   std::string rng_str;
-  uint64_t seed;
+  uint64_t seed, iteration_seed;
   int deterministic;
+  bool actor_rng_streams; // every actor draws from its own rng, reseeded each iteration ( deterministic sims )
   int average_range, average_gauss;
   int convergence_scale;
 
@@ -1644,11 +1834,14 @@ struct sim_t : private sc_thread_t
 
   // Reporting
   progress_bar_t progress_bar;
+  iteration_design_t iteration_design;
   std::unique_ptr<scaling_t> scaling;
   std::unique_ptr<plot_t> plot;
   std::unique_ptr<reforge_plot_t> reforge_plot;
   double elapsed_cpu;
   double elapsed_time;
+  double elapsed_merge_time; // Wall time from the last thread finishing its iterations to the end of the merge
+  double iteration_end_time;
   double     iteration_dmg, priority_iteration_dmg,  iteration_heal, iteration_absorb;
   simple_sample_data_t raid_dps, total_dmg, raid_hps, total_heal, total_absorb, raid_aps;
   extended_sample_data_t simulation_length;
@@ -1689,6 +1882,8 @@ struct sim_t : private sc_thread_t
   int save_raid_summary;
   int save_gear_comments;
   int statistics_level;
+  std::string quantile_sketch_str; // Player metrics collected in a quantile sketch instead of raw samples
+  double quantile_sketch_accuracy;
   int separate_stats_by_actions;
   int report_raid_summary;
   int buff_uptime_timeline;
@@ -1703,13 +1898,13 @@ struct sim_t : private sc_thread_t
   std::string apikey;
   bool ilevel_raid_report;
   bool distance_targeting_enabled;
+  spatial_index_t spatial_index;
   bool enable_dps_healing;
   double scaling_normalized;
 
   sim_report_information_t report_information;
 
   // Multi-Threading
-  mutex_t merge_mutex;
   int threads;
   std::vector<sim_t*> children; // Manual delete!
   int thread_index;
@@ -1721,31 +1916,90 @@ struct sim_t : private sc_thread_t
     double pct() const
     { return current_iterations / static_cast<double>(total_iterations); }
   };
+  // Shared pool of iterations. Threads claim iterations in batches with a
+  // lock-free compare-and-swap on the work counter; batch sizes shrink as the
+  // pool drains (guided scheduling), so threads run out of work together.
   struct work_queue_t
   {
-    private:
-    mutex_t m;
-    public:
-    int total_work, projected_work, work;
-    work_queue_t() : total_work( 0 ), projected_work( 0 ), work( 0 ) {}
-    void init( int w )    { AUTO_LOCK(m); total_work = projected_work = w; }
-    void flush()          { AUTO_LOCK(m); total_work = projected_work = work; }
-    void project( int w ) { AUTO_LOCK(m); projected_work = w; assert(w>=work); }
-    int  size()           { AUTO_LOCK(m); return total_work; }
-    bool pop()         
-    { 
-      AUTO_LOCK(m); 
-      if( work >= total_work ) return false; 
-      if( ++work == total_work ) projected_work = work;
-      return work < total_work;
+    // Iterations claimed by one thread, but not run yet. A flush of the queue
+    // invalidates all outstanding batches. Index is the position of the last
+    // popped iteration in the queue.
+    struct batch_t
+    {
+      int remaining, flush_count, index;
+      batch_t() : remaining( 0 ), flush_count( 0 ), index( -1 ) {}
+    };
+
+    std::atomic<int> total_work, projected_work, work, flush_count;
+    // Iterations run to completion. Work counts claimed iterations, some of
+    // which may still be running.
+    std::atomic<int> completed;
+    work_queue_t() : total_work( 0 ), projected_work( 0 ), work( 0 ), flush_count( 0 ), completed( 0 ) {}
+    void init( int w )    { total_work = w; projected_work = w; completed = 0; }
+    void flush()          { int w = work; total_work = w; projected_work = w; ++flush_count; }
+    void project( int w ) { projected_work = std::max( w, work.load() ); }
+    void complete()       { completed.fetch_add( 1, std::memory_order_relaxed ); }
+    int  size()           { return total_work; }
+    int  claim( int workers, int& start );
+    bool pop( batch_t& batch, int workers = 1 )
+    {
+      if ( batch.remaining > 0 && batch.flush_count == flush_count.load( std::memory_order_relaxed ) )
+      {
+        batch.remaining--;
+        batch.index++;
+        return true;
+      }
+
+      batch.flush_count = flush_count;
+      batch.remaining = claim( workers, batch.index );
+      if ( batch.remaining == 0 )
+        return false;
+
+      batch.remaining--;
+      return true;
     }
     sim_progress_t progress()
     {
-      AUTO_LOCK(m);
-      return sim_progress_t{work, projected_work };
+      return sim_progress_t{ completed, projected_work };
     }
   };
   std::shared_ptr<work_queue_t> work_queue;
+  work_queue_t::batch_t work_batch;
+
+  // Pools the target metric of all threads for target_error. Each thread owns
+  // one slot, which it republishes with the running statistics of its actors
+  // at batch granularity. The statistics are stored in atomics, and a sequence
+  // counter per slot lets readers take a consistent copy without either side
+  // locking.
+  struct convergence_monitor_t
+  {
+    struct moments_t
+    {
+      std::atomic<double> sum, running_mean, m2;
+      std::atomic<size_t> count;
+      moments_t() : sum( 0 ), running_mean( 0 ), m2( 0 ), count( 0 ) {}
+    };
+
+    struct slot_t
+    {
+      std::atomic<unsigned> sequence;
+      std::atomic<size_t> size; // set once, after data is allocated
+      std::unique_ptr<moments_t[]> data;
+      slot_t() : sequence( 0 ), size( 0 ), data() {}
+    };
+
+    std::vector<slot_t> slots;
+    std::atomic<bool> converged;
+    // Iterations run when target_error was met, and the iterations left in the queue at that point
+    std::atomic<int> converged_iterations, iterations_saved;
+
+    convergence_monitor_t() : slots(), converged( false ), converged_iterations( 0 ), iterations_saved( 0 ) {}
+    void init( int threads )
+    { slots = std::vector<slot_t>( threads ); }
+    void publish( int thread, const std::vector<player_t*>& actors );
+    simple_sample_data_t pooled( size_t actor ) const;
+  };
+  std::shared_ptr<convergence_monitor_t> convergence;
 
   // Related Simulations
   mutex_t relatives_mutex;
@@ -1786,6 +2040,7 @@ struct sim_t : private sc_thread_t
   virtual void run() override;
   int       main( const std::vector<std::string>& args );
   double    iteration_time_adjust() const;
+  double    iteration_health_adjust() const;
   double    expected_max_time() const;
   bool      is_canceled() const;
   void      cancel_iteration();
@@ -1808,6 +2063,7 @@ struct sim_t : private sc_thread_t
   void      analyze();
   void      merge( sim_t& other_sim );
   void      merge();
+  void      merge_tree();
   bool      iterate();
   void      partition();
   bool      execute();
@@ -1951,6 +2207,12 @@ struct scaling_t
   std::string scale_over;
   scale_metric_e scaling_metric;
   std::string scale_over_player;
+  int scale_factor_concurrency;
+  int common_random_numbers; // ref and delta sims replay the same random numbers for each iteration
+
+  // Delta sims of a concurrent scaling pass that have not been analyzed yet
+  std::vector<sim_t*> concurrent_sims;
+  int completed_sims;
 
   // Gear delta for determining scale factors
   gear_stats_t stats;
@@ -1960,6 +2222,10 @@ struct scaling_t
   void init_deltas();
   void analyze();
   void analyze_stats();
+  void analyze_stats_sequential( const std::vector<stat_e>& );
+  void analyze_stats_concurrent( const std::vector<stat_e>&, int concurrency );
+  void analyze_stat_results( stat_e, double scale_delta, bool center, sim_t* ref_sim, sim_t* delta_sim );
+  sim_t* create_delta_sim( stat_e, double value, bool reference );
   void analyze_ability_stats( stat_e, double, player_t*, player_t*, player_t* );
   void analyze_lag();
   void normalize();
@@ -2040,11 +2306,13 @@ struct event_t : private noncopyable
 {
   sim_t& _sim;
   event_t*    next;
+  event_t*    prev;
   timespan_t  time;
   timespan_t  reschedule_time;
   uint32_t    id;
   bool        canceled;
   bool        recycled;
+  bool        in_wheel;
 #if ACTOR_EVENT_BOOKKEEPING
   actor_t*    actor;
 #endif
@@ -3048,7 +3316,8 @@ struct player_collected_data_t
 
   // Metric used to end simulations early
   extended_sample_data_t target_metric;
-  mutex_t target_metric_mutex;
+  // Iteration index of each sample, in the order of the full sample data ( common random numbers )
+  std::vector<int> iteration_index;
 
   std::array<simple_sample_data_t,RESOURCE_MAX> resource_lost, resource_gained;
   struct resource_timeline_t
@@ -3162,7 +3431,10 @@ struct player_collected_data_t
   } buffed_stats_snapshot;
 
   player_collected_data_t( const std::string& player_name, sim_t& );
+  void init_quantile_sketches( const sim_t& );
   void reserve_memory( const player_t& );
+  void reserve_timelines( const player_t& );
+  size_t timeline_overflows() const;
   void merge( const player_collected_data_t& );
   void analyze( const player_t& );
   void collect_data( const player_t& );
@@ -3542,6 +3814,7 @@ struct player_t : public actor_t
   bool use_default_action_list;
   auto_dispose< std::vector<dot_t*> > dot_list;
   auto_dispose< std::vector<action_priority_list_t*> > action_priority_list;
+  auto_dispose< std::vector<expr_t*> > shared_expressions; // see expr_t::optimize_action_list
   std::vector<action_t*> precombat_action_list;
   action_priority_list_t* active_action_list;
   action_priority_list_t* active_off_gcd_list;
@@ -3614,6 +3887,10 @@ struct player_t : public actor_t
   std::array<gear_stats_t, SCALE_METRIC_MAX> scaling_error;
   std::array<gear_stats_t, SCALE_METRIC_MAX> scaling_delta_dps;
   std::array<gear_stats_t, SCALE_METRIC_MAX> scaling_compare_error;
+  // Common random numbers: correlation of the paired ref/delta iterations, and
+  // the factor by which it reduces the variance of the scale factor
+  std::array<gear_stats_t, SCALE_METRIC_MAX> scaling_correlation;
+  std::array<gear_stats_t, SCALE_METRIC_MAX> scaling_variance_reduction;
   std::array<double, SCALE_METRIC_MAX> scaling_lag, scaling_lag_error;
   std::array<bool, STAT_MAX> scales_with;
   std::array<double, STAT_MAX> over_cap;
@@ -4136,6 +4413,7 @@ struct player_t : public actor_t
   double      get_player_distance( player_t& );
   double      get_ground_aoe_distance( action_state_t& );
   double      get_position_distance( double m = 0, double v = 0 );
+  void        set_position( double x, double y );
   action_priority_list_t* get_action_priority_list( const std::string& name, const std::string& comment = std::string() );
 
   // Targetdata stuff
@@ -4153,6 +4431,7 @@ struct player_t : public actor_t
   virtual void analyze( sim_t& );
 
   scaling_metric_data_t scaling_for_metric( scale_metric_e metric ) const;
+  const extended_sample_data_t* scaling_sample_data( scale_metric_e metric, const std::vector<int>*& iteration_index ) const;
 
   void change_position( position_e );
   position_e position() const
@@ -4163,8 +4442,9 @@ struct player_t : public actor_t
   virtual bool requires_data_collection() const
   { return active_during_iteration; }
 
-  rng::rng_t& rng() { return sim -> rng(); }
-  rng::rng_t& rng() const { return sim -> rng(); }
+  std::unique_ptr<rng::rng_t> actor_rng; // see sim_t::actor_rng_streams
+  rng::rng_t& rng() { return actor_rng ? *actor_rng : sim -> rng(); }
+  rng::rng_t& rng() const { return actor_rng ? *actor_rng : sim -> rng(); }
   std::vector<action_variable_t> variables;
   // Add 1ms of time to ensure that we finish this run. This is necessary due
   // to the millisecond accuracy in our timing system.
@@ -4663,6 +4943,94 @@ public:
   bool has_tick_amount_results() const;
 };
 
+// CPU Profile ==============================================================
+
+/* Sampled wall clock time spent in the hot parts of an action, enabled with
+ * profile_cpu=N. One in every N calls of each part is timed, the estimated
+ * total is the sampled time scaled by calls / samples. Times are inclusive,
+ * an execute includes the callbacks and zero travel time impacts it causes.
+ */
+struct cpu_profile_t
+{
+  enum part_e { READY, CONDITION, EXECUTE, IMPACT, CALLBACKS, PART_MAX };
+
+  struct part_t
+  {
+    uint64_t calls, samples;
+    double time;
+    part_t() : calls( 0 ), samples( 0 ), time( 0 ) {}
+  };
+
+  std::array<part_t, PART_MAX> parts;
+
+  void merge( const cpu_profile_t& other )
+  {
+    for ( size_t i = 0; i < parts.size(); ++i )
+    {
+      parts[ i ].calls   += other.parts[ i ].calls;
+      parts[ i ].samples += other.parts[ i ].samples;
+      parts[ i ].time    += other.parts[ i ].time;
+    }
+  }
+
+  double estimate( part_e p ) const
+  {
+    const part_t& pt = parts[ p ];
+    return pt.samples ? pt.time * pt.calls / pt.samples : 0.0;
+  }
+
+  double total() const
+  {
+    double t = 0;
+    for ( part_e p = READY; p < PART_MAX; p = static_cast<part_e>( p + 1 ) )
+      t += estimate( p );
+    return t;
+  }
+
+  static const char* part_name( part_e p )
+  {
+    switch ( p )
+    {
+      case READY:     return "ready";
+      case CONDITION: return "condition";
+      case EXECUTE:   return "execute";
+      case IMPACT:    return "impact";
+      case CALLBACKS: return "callbacks";
+      default:        return "unknown";
+    }
+  }
+};
+
+// Times one part of an action for the lifetime of the object, when sampled
+struct cpu_profile_scope_t : private noncopyable
+{
+  cpu_profile_t::part_t* part;
+  std::chrono::steady_clock::time_point start;
+
+  cpu_profile_scope_t( const sim_t& sim, cpu_profile_t& profile, cpu_profile_t::part_e p ) :
+    part( nullptr )
+  {
+    if ( sim.profile_cpu <= 0 )
+      return;
+
+    cpu_profile_t::part_t& pt = profile.parts[ p ];
+    if ( pt.calls++ % static_cast<uint64_t>( sim.profile_cpu ) != 0 )
+      return;
+
+    part = &pt;
+    start = std::chrono::steady_clock::now();
+  }
+
+  ~cpu_profile_scope_t()
+  {
+    if ( ! part )
+      return;
+
+    part -> samples++;
+    part -> time += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  }
+};
+
 struct action_state_t : private noncopyable
 {
   action_state_t* next;
@@ -5118,6 +5486,8 @@ public:
   action_priority_list_t* action_list;
   proc_t* starved_proc;
   int64_t total_executions;
+  cpu_profile_t cpu_profile;
+  cpu_profile_t::part_t condition_profile; // cpu_profile of the conditions up to expr_t::optimize_action_list
   cooldown_t line_cooldown; // specific to action_t object, not shared by name
   const action_priority_t* signature;
   std::vector<std::unique_ptr<option_t>> options;
@@ -5153,10 +5523,10 @@ public:
   void remove_travel_event( travel_event_t* e );
 
   rng::rng_t& rng()
-  { return sim -> rng(); }
+  { return player -> rng(); }
 
   rng::rng_t& rng() const
-  { return sim -> rng(); }
+  { return player -> rng(); }
 
   // =======================
   // Const virtual functions
@@ -7030,7 +7400,7 @@ inline std::string buff_t::source_name() const
   return "noone";
 }
 inline rng::rng_t& buff_t::rng()
-{ return sim -> rng(); }
+{ return player ? player -> rng() : sim -> rng(); }
 // sim_t inlines
 
 inline buff_creator_t::operator buff_t* () const
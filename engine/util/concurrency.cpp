@@ -7,6 +7,10 @@
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
 #include <chrono>
 
 // C++11 STL multi-threading hook-ups
@@ -30,29 +34,115 @@ public:
   { return m.native_handle(); }
 };
 
+namespace { // UNNAMED NAMESPACE
+
+/* Process-wide pool of worker threads.
+ *
+ * Launching a sc_thread_t hands its run() to an idle worker instead of
+ * starting a new OS thread. Workers are created on demand, so there is always
+ * one available for every launched thread, and are parked between tasks. The
+ * repeated thread sets of the main, scaling, plot and reforge plot sims thus
+ * reuse the same OS threads.
+ */
+class thread_pool_t : private nonmoveable
+{
+private:
+  std::mutex m;
+  std::condition_variable task_ready;
+  std::deque<std::function<void()> > tasks;
+  std::vector<std::thread> workers;
+  size_t idle_workers;
+  bool stop;
+
+  void work()
+  {
+    std::unique_lock<std::mutex> lock( m );
+    while ( true )
+    {
+      idle_workers++;
+      task_ready.wait( lock, [ this ]() { return stop || ! tasks.empty(); } );
+      idle_workers--;
+
+      if ( tasks.empty() )
+        return;
+
+      std::function<void()> task = std::move( tasks.front() );
+      tasks.pop_front();
+
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+
+public:
+  thread_pool_t() :
+    idle_workers( 0 ), stop( false )
+  { }
+
+  ~thread_pool_t()
+  {
+    {
+      std::lock_guard<std::mutex> lock( m );
+      stop = true;
+    }
+    task_ready.notify_all();
+
+    for ( auto& worker : workers )
+      worker.join();
+  }
+
+  void submit( std::function<void()> task )
+  {
+    {
+      std::lock_guard<std::mutex> lock( m );
+      tasks.push_back( std::move( task ) );
+      if ( tasks.size() > idle_workers )
+        workers.push_back( std::thread( &thread_pool_t::work, this ) );
+    }
+    task_ready.notify_one();
+  }
+
+  static thread_pool_t& instance()
+  {
+    static thread_pool_t pool;
+    return pool;
+  }
+};
+
+} // UNNAMED NAMESPACE
+
 class sc_thread_t::native_t
 {
 private:
-  std::unique_ptr<std::thread> t;
+  std::mutex m;
+  std::condition_variable done;
+  bool running;
 
-  static void execute( sc_thread_t* t )
+  void finish()
   {
-    t -> run();
+    std::lock_guard<std::mutex> lock( m );
+    running = false;
+    done.notify_all();
   }
 public:
   native_t() :
-  t()
+    running( false )
   { }
 
-  void launch( sc_thread_t* thr)
+  void launch( sc_thread_t* thr )
   {
-    t = std::unique_ptr<std::thread>( new std::thread( &sc_thread_t::native_t::execute, thr ) );
+    running = true;
+    thread_pool_t::instance().submit( [ this, thr ]() {
+      thr -> run();
+      finish();
+    } );
   }
 
-  void join() {
-    if ( t && t -> joinable() ) {
-      t -> join();
-    }
+  void join()
+  {
+    std::unique_lock<std::mutex> lock( m );
+    done.wait( lock, [ this ]() { return ! running; } );
   }
 
   static void sleep_seconds( double t )
@@ -94,6 +184,10 @@ sc_thread_t::~sc_thread_t()
 
 // sc_thread_t::launch() ====================================================
 
+/**
+ * @brief Run the thread on a worker of the process-wide thread pool.
+ */
+
 void sc_thread_t::launch()
 { native_handle -> launch( this ); }
 
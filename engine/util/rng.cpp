@@ -4,9 +4,12 @@
 // ==========================================================================
 //#include "dbc/dbc.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <ctime>
 #include <stdint.h>
 #include <string>
+#include <vector>
 #include "rng.hpp"
 
 // Pseudo-Random Number Generation ==========================================
@@ -63,40 +66,40 @@ double convert_to_double_0_1( uint64_t ui64 )
  * maintenance cost.
  * Unfortunately, it is slower than the dsfmt implementation.
  */
-struct rng_mt_cxx11_t : public rng_t
+struct rng_mt_cxx11_t
 {
   std::mt19937 engine; // Mersenne twister MT19937
   std::uniform_real_distribution<double> dist;
 
   rng_mt_cxx11_t() : dist(0,1) {}
 
-  virtual const char* name() const override { return "mt_cxx11"; }
+  const char* name() const { return "mt_cxx11"; }
 
-  virtual void seed( uint64_t start ) override
+  void seed( uint64_t start )
   { 
     engine.seed( (unsigned) start ); 
   }
 
-  virtual double real() override
+  double real()
   { 
     return dist( engine );
   }
 };
 
-struct rng_mt_cxx11_64_t : public rng_t
+struct rng_mt_cxx11_64_t
 {
   std::mt19937_64 engine; // Mersenne twister MT19937
 
   rng_mt_cxx11_64_t() = default;
 
-  virtual const char* name() const override { return "mt_cxx11_64"; }
+  const char* name() const { return "mt_cxx11_64"; }
 
-  virtual void seed( uint64_t start ) override
+  void seed( uint64_t start )
   {
     engine.seed( start );
   }
 
-  virtual double real() override
+  double real()
   {
     return convert_to_double_0_1(engine());
   }
@@ -108,7 +111,7 @@ struct rng_mt_cxx11_64_t : public rng_t
  *
  * All credit goes to https://code.google.com/p/smhasher
  */
-struct rng_murmurhash_t : public rng_t
+struct rng_murmurhash_t
 {
   uint64_t x; /* The state must be seeded with a nonzero value. */
 
@@ -121,15 +124,15 @@ struct rng_murmurhash_t : public rng_t
     return x ^= x >> 33;
   }
 
-  virtual const char* name() const override { return "murmurhash3"; }
+  const char* name() const { return "murmurhash3"; }
 
-  virtual void seed( uint64_t start ) override
+  void seed( uint64_t start )
   { 
     assert( start != 0 );
     x = start;
   }
 
-  virtual double real() override
+  double real()
   { 
     return convert_to_double_0_1( next() );
   }
@@ -142,7 +145,7 @@ struct rng_murmurhash_t : public rng_t
  * All credit goes to Sebastiano Vigna (vigna@acm.org) @2014
  * http://xorshift.di.unimi.it/
  */
-struct rng_xorshift64_t : public rng_t
+struct rng_xorshift64_t
 {
   uint64_t x; /* The state must be seeded with a nonzero value. */
 
@@ -154,15 +157,15 @@ struct rng_xorshift64_t : public rng_t
     return x * 2685821657736338717LL;
   }
 
-  virtual const char* name() const override { return "xorshift64"; }
+  const char* name() const { return "xorshift64"; }
 
-  virtual void seed( uint64_t start ) override
+  void seed( uint64_t start )
   { 
     assert( start != 0 );
     x = start;
   }
 
-  virtual double real() override
+  double real()
   { 
     return convert_to_double_0_1( next() );
   }
@@ -175,7 +178,7 @@ struct rng_xorshift64_t : public rng_t
  * All credit goes to Sebastiano Vigna (vigna@acm.org) @2014
  * http://xorshift.di.unimi.it/
  */
-struct rng_xorshift128_t : public rng_t
+struct rng_xorshift128_t
 {
   uint64_t s[ 2 ];
 
@@ -188,9 +191,9 @@ struct rng_xorshift128_t : public rng_t
     return ( s[ 1 ] = ( s1 ^ s0 ^ ( s1 >> 17 ) ^ ( s0 >> 26 ) ) ) + s0; // b, c
   }
 
-  virtual const char* name() const override { return "xorshift128"; }
+  const char* name() const { return "xorshift128"; }
 
-  virtual void seed( uint64_t start ) override
+  void seed( uint64_t start )
   { 
     rng_murmurhash_t mmh;
     mmh.seed( start );
@@ -199,7 +202,7 @@ struct rng_xorshift128_t : public rng_t
     s[ 1 ] = mmh.next();
   }
 
-  virtual double real() override
+  double real()
   { 
     return convert_to_double_0_1( next() );
   }
@@ -212,7 +215,7 @@ struct rng_xorshift128_t : public rng_t
  * All credit goes to Sebastiano Vigna (vigna@acm.org) @2014
  * http://xorshift.di.unimi.it/
  */
-struct rng_xorshift1024_t : public rng_t
+struct rng_xorshift1024_t
 {
   uint64_t s[ 16 ]; 
   int p;
@@ -227,9 +230,9 @@ struct rng_xorshift1024_t : public rng_t
     return ( s[ p ] = s0 ^ s1 ) * 1181783497276652981LL; 
   }
 
-  virtual const char* name() const override { return "xorshift1024"; }
+  const char* name() const { return "xorshift1024"; }
 
-  virtual void seed( uint64_t start ) override
+  void seed( uint64_t start )
   { 
     rng_xorshift64_t xs64;
     xs64.seed( start );
@@ -237,7 +240,7 @@ struct rng_xorshift1024_t : public rng_t
     p = 0;
   }
 
-  virtual double real() override
+  double real()
   { 
     return convert_to_double_0_1( next() );
   }
@@ -257,7 +260,7 @@ struct rng_xorshift1024_t : public rng_t
  *
  * The new BSD License is applied to this software.
  */
-struct rng_sfmt_t : public rng_t
+struct rng_sfmt_t
 {
   /** 128-bit data structure */
   union w128_t
@@ -481,21 +484,63 @@ struct rng_sfmt_t : public rng_t
     return psfmt64[dsfmt->idx++];
   }
 
+  /**
+   * Fill a block with numbers in [0,1), straight from the state array
+   * instead of one call per number.
+   */
+  void dsfmt_fill_close_open( dsfmt_t *dsfmt, double* block, size_t n )
+  {
+    double *psfmt64 = &dsfmt->status[0].d[0];
+
+    while ( n > 0 )
+    {
+      if ( dsfmt->idx >= DSFMT_N64 )
+      {
+        dsfmt_gen_rand_all( dsfmt );
+        dsfmt->idx = 0;
+      }
+
+      size_t count = std::min( n, static_cast<size_t>( DSFMT_N64 - dsfmt->idx ) );
+      const double* src = psfmt64 + dsfmt->idx;
+      size_t i = 0;
+#if defined(RNG_USE_SSE2)
+      // Whole state is 16 byte aligned, the block at least as much, so only an
+      // odd state index needs a scalar lead-in
+      if ( ( dsfmt->idx & 1 ) && count > 0 )
+      {
+        block[ 0 ] = src[ 0 ] - 1.0;
+        i = 1;
+      }
+      const __m128d one = _mm_set1_pd( 1.0 );
+      if ( ( reinterpret_cast<uintptr_t>( block + i ) & 15 ) == 0 )
+      {
+        for ( ; i + 2 <= count; i += 2 )
+          _mm_store_pd( block + i, _mm_sub_pd( _mm_load_pd( src + i ), one ) );
+      }
+      else
+      {
+        for ( ; i + 2 <= count; i += 2 )
+          _mm_storeu_pd( block + i, _mm_sub_pd( _mm_load_pd( src + i ), one ) );
+      }
+#endif
+      for ( ; i < count; ++i )
+        block[ i ] = src[ i ] - 1.0;
+
+      dsfmt->idx += static_cast<int>( count );
+      block += count;
+      n -= count;
+    }
+  }
+
 #if defined(RNG_USE_SSE2)
   rng_sfmt_t()
   {
     // Validate proper alignment for SSE2 types.
     assert( ( uintptr_t ) dsfmt_global_data.status % 16 == 0 );
   }
-  // 32-bit libraries typically align malloc chunks to sizeof(double) == 8.
-  // This object needs to be aligned to sizeof(__m128d) == 16.
-  static void* operator new( size_t size )
-  { return _mm_malloc( size, sizeof( __m128d ) ); }
-  static void operator delete( void* p )
-  { return _mm_free( p ); }
 #endif
 
-  virtual const char* name() const override {
+  const char* name() const {
 #ifdef RNG_USE_SSE2
     return "sse2-sfmt";
 #else
@@ -503,25 +548,27 @@ struct rng_sfmt_t : public rng_t
 #endif
   }
   
-  virtual void seed( uint64_t start ) override
+  void seed( uint64_t start )
   { 
     dsfmt_chk_init_gen_rand( &dsfmt_global_data, (uint32_t) start ); 
   }
 
-  virtual double real() override
+  double real()
   { 
     return dsfmt_genrand_close_open( &dsfmt_global_data ) - 1.0; 
   }
 
+  void fill( double* block, size_t n )
+  {
+    dsfmt_fill_close_open( &dsfmt_global_data, block, n );
+  }
+
   /**
-   * Special implementation because dsfmt only allows 32bit seed
+   * dsfmt only allows 32bit seeds, reseed from its integer output
    */
-  virtual uint64_t reseed() override
+  uint64_t next_seed()
   {
-    uint64_t s = dsfmt_genrand_uint32( &dsfmt_global_data );
-    seed( s );
-    reset();
-    return s;
+    return dsfmt_genrand_uint32( &dsfmt_global_data );
   }
 };
 
@@ -536,7 +583,7 @@ struct rng_sfmt_t : public rng_t
  * Hiroshima University and The University of Tokyo.
  * All rights reserved.
  */
-struct rng_tinymt_t : public rng_t
+struct rng_tinymt_t
 {
   static const uint64_t TINYMT64_SH0  = 12;
   static const uint64_t TINYMT64_SH1  = 11;
@@ -601,9 +648,9 @@ struct rng_tinymt_t : public rng_t
     period_certification();
   }
 
-  virtual const char* name() const override { return "tinymt"; }
+  const char* name() const { return "tinymt"; }
 
-  virtual void seed( uint64_t start ) override
+  void seed( uint64_t start )
   {
     // mat1, mat2, and tmat are inputs to the engine
     // I am uncertain how to set them so we'll just grind the seed through MurmurHash.
@@ -616,15 +663,279 @@ struct rng_tinymt_t : public rng_t
     init( start );
   }
 
-  virtual double real() override
+  double real()
   {
     next_state();
     return temper_conv_open() - 1.0;
   }
 };
 
+/**
+ * @brief Philox-4x32-10 counter-based Random Number Generator
+ *
+ * Every block of random bits is a keyed bijection of a 128-bit counter, so
+ * any position of any stream can be computed directly, without a state that
+ * depends on previously drawn numbers. The key selects the iteration, the
+ * upper counter words the actor and stream; the lower words count blocks.
+ *
+ * All credit goes to Salmon, Moraes, Dror and Shaw, "Parallel Random
+ * Numbers: As Easy as 1, 2, 3" (SC11) and http://www.deshawresearch.com/resources_random123.html
+ */
+struct rng_philox_t
+{
+  static const uint32_t PHILOX_M0 = 0xD2511F53;
+  static const uint32_t PHILOX_M1 = 0xCD9E8D57;
+  static const uint32_t PHILOX_W0 = 0x9E3779B9;
+  static const uint32_t PHILOX_W1 = 0xBB67AE85;
+  static const int PHILOX_ROUNDS = 10;
+
+  uint32_t key[ 2 ];
+  uint32_t ctr[ 4 ];
+  uint64_t out[ 2 ];
+  int idx;
+
+  /// Philox bijection of 'c' under 'k'
+  static void block( const uint32_t c[ 4 ], const uint32_t k[ 2 ], uint32_t r[ 4 ] )
+  {
+    uint32_t x0 = c[ 0 ], x1 = c[ 1 ], x2 = c[ 2 ], x3 = c[ 3 ];
+    uint32_t k0 = k[ 0 ], k1 = k[ 1 ];
+
+    for ( int i = 0; i < PHILOX_ROUNDS; i++ )
+    {
+      uint64_t p0 = uint64_t( PHILOX_M0 ) * x0;
+      uint64_t p1 = uint64_t( PHILOX_M1 ) * x2;
+      uint32_t y0 = uint32_t( p1 >> 32 ) ^ x1 ^ k0;
+      uint32_t y1 = uint32_t( p1 );
+      uint32_t y2 = uint32_t( p0 >> 32 ) ^ x3 ^ k1;
+      uint32_t y3 = uint32_t( p0 );
+      x0 = y0; x1 = y1; x2 = y2; x3 = y3;
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
+    }
+
+    r[ 0 ] = x0; r[ 1 ] = x1; r[ 2 ] = x2; r[ 3 ] = x3;
+  }
+
+  void next_block()
+  {
+    uint32_t r[ 4 ];
+    block( ctr, key, r );
+    out[ 0 ] = uint64_t( r[ 0 ] ) | ( uint64_t( r[ 1 ] ) << 32 );
+    out[ 1 ] = uint64_t( r[ 2 ] ) | ( uint64_t( r[ 3 ] ) << 32 );
+    if ( ++ctr[ 0 ] == 0 )
+      ++ctr[ 1 ];
+    idx = 0;
+  }
+
+  uint64_t next()
+  {
+    if ( idx >= 2 )
+      next_block();
+    return out[ idx++ ];
+  }
+
+  /// Start of the stream of the given actor and purpose under key 'k'
+  void set_stream( uint64_t k, uint64_t actor, uint64_t stream )
+  {
+    assert( actor <= 0xFFFFFFFF && stream <= 0xFFFFFFFF );
+    key[ 0 ] = uint32_t( k );
+    key[ 1 ] = uint32_t( k >> 32 );
+    ctr[ 0 ] = ctr[ 1 ] = 0;
+    ctr[ 2 ] = uint32_t( actor );
+    ctr[ 3 ] = uint32_t( stream );
+    idx = 2;
+  }
+
+  const char* name() const { return "philox"; }
+
+  void seed( uint64_t start )
+  {
+    set_stream( start, 0, 0 );
+  }
+
+  double real()
+  {
+    return convert_to_double_0_1( next() );
+  }
+};
+
+/**
+ * @brief Fill a block from an engine, one number at a time
+ *
+ * Engines that produce whole blocks natively ( sfmt ) provide their own fill().
+ */
+template <typename Engine>
+void fill( Engine& engine, double* block, size_t n )
+{
+  for ( size_t i = 0; i < n; ++i )
+    block[ i ] = engine.real();
+}
+
+void fill( rng_sfmt_t& engine, double* block, size_t n )
+{ engine.fill( block, n ); }
+
+/**
+ * @brief rng_t front-end for a given engine type
+ *
+ * The engine is a template parameter, so it is known at compile time and the
+ * whole block refill inlines into a single loop. rng_t::real() only reads
+ * from the buffer, the virtual call is made once per buffer.
+ */
+template <typename Engine>
+struct rng_engine_t final : public rng_t
+{
+  Engine engine;
+
+  const char* name() const override
+  { return engine.name(); }
+
+  void seed( uint64_t start ) override
+  {
+    engine.seed( start );
+    discard_buffer();
+  }
+
+  void seed_stream( uint64_t seed, uint64_t iteration, uint64_t actor, uint64_t stream ) override
+  { rng_t::seed_stream( seed, iteration, actor, stream ); }
+
+  uint64_t reseed() override
+  { return rng_t::reseed(); }
+
+protected:
+  void generate( double* block, size_t n ) override
+  { fill( engine, block, n ); }
+};
+
+/// Special implementation because dsfmt only allows 32bit seed
+template <>
+uint64_t rng_engine_t<rng_sfmt_t>::reseed()
+{
+  uint64_t s = engine.next_seed();
+  seed( s );
+  reset();
+  return s;
+}
+
+/**
+ * Philox keys the iteration and counts actor and stream in the counter, so
+ * streams of one iteration are disjoint by construction instead of by
+ * hashing.
+ */
+template <>
+void rng_engine_t<rng_philox_t>::seed_stream( uint64_t seed, uint64_t iteration, uint64_t actor, uint64_t stream )
+{
+  engine.set_stream( stream_seed( seed, iteration ), actor, stream );
+  discard_buffer();
+}
+
+/**
+ * @brief Ziggurat tables for the standard normal and exponential distribution
+ *
+ * Marsaglia & Tsang, "The Ziggurat Method for Generating Random Variables"
+ * (2000), in the double precision form of Doornik, "An Improved Ziggurat
+ * Method to Generate Normal Random Samples" (2005).
+ *
+ * Layer i covers [0, x[i]) between the density heights f[i] and f[i+1]. Layer
+ * 0 is the base strip including the tail beyond R. All layers, and the base
+ * with its tail, have the same area V. Filled once by rng::create.
+ */
+const double ZIGGURAT_NORMAL_R = 3.442619855899;
+const double ZIGGURAT_NORMAL_V = 9.91256303526217e-3;
+const double ZIGGURAT_EXP_R = 7.69711747013104972;
+const double ZIGGURAT_EXP_V = 3.949659822581572e-3;
+
+struct ziggurat_t
+{
+  static const int NORMAL_LAYERS = 128;
+  static const int EXP_LAYERS = 256;
+
+  double normal_x[ NORMAL_LAYERS + 1 ], normal_ratio[ NORMAL_LAYERS ], normal_f[ NORMAL_LAYERS + 1 ];
+  double exp_x[ EXP_LAYERS + 1 ], exp_ratio[ EXP_LAYERS ], exp_f[ EXP_LAYERS + 1 ];
+  bool initialized;
+
+  void init()
+  {
+    // f( x ) = exp( -x^2 / 2 ), unnormalized normal density
+    double f = std::exp( -0.5 * ZIGGURAT_NORMAL_R * ZIGGURAT_NORMAL_R );
+    normal_x[ 0 ] = ZIGGURAT_NORMAL_V / f;
+    normal_x[ 1 ] = ZIGGURAT_NORMAL_R;
+    normal_x[ NORMAL_LAYERS ] = 0;
+    for ( int i = 2; i < NORMAL_LAYERS; i++ )
+    {
+      normal_x[ i ] = std::sqrt( -2.0 * std::log( ZIGGURAT_NORMAL_V / normal_x[ i - 1 ] + f ) );
+      f = std::exp( -0.5 * normal_x[ i ] * normal_x[ i ] );
+    }
+    for ( int i = 0; i <= NORMAL_LAYERS; i++ )
+      normal_f[ i ] = std::exp( -0.5 * normal_x[ i ] * normal_x[ i ] );
+    for ( int i = 0; i < NORMAL_LAYERS; i++ )
+      normal_ratio[ i ] = normal_x[ i + 1 ] / normal_x[ i ];
+
+    // f( x ) = exp( -x ), exponential density
+    f = std::exp( -ZIGGURAT_EXP_R );
+    exp_x[ 0 ] = ZIGGURAT_EXP_V / f;
+    exp_x[ 1 ] = ZIGGURAT_EXP_R;
+    exp_x[ EXP_LAYERS ] = 0;
+    for ( int i = 2; i < EXP_LAYERS; i++ )
+    {
+      exp_x[ i ] = -std::log( ZIGGURAT_EXP_V / exp_x[ i - 1 ] + f );
+      f = std::exp( -exp_x[ i ] );
+    }
+    for ( int i = 0; i <= EXP_LAYERS; i++ )
+      exp_f[ i ] = std::exp( -exp_x[ i ] );
+    for ( int i = 0; i < EXP_LAYERS; i++ )
+      exp_ratio[ i ] = exp_x[ i + 1 ] / exp_x[ i ];
+
+    initialized = true;
+  }
+};
+
+ziggurat_t ziggurat;
+
+void init_ziggurat()
+{
+  // Thread-safe one time initialization
+  static const bool init = ( ziggurat.init(), true );
+  (void) init;
+}
+
 } // unnamed
 
+// ==========================================================================
+// Buffered Front-End
+// ==========================================================================
+
+/// Refill the buffer in one go from the engine
+void rng_t::refill()
+{
+  generate( buffer, BUFFER_SIZE );
+  buffer_pos = 0;
+}
+
+/// Drop any buffered numbers, so the next real() continues from the engine
+void rng_t::discard_buffer()
+{
+  buffer_pos = BUFFER_SIZE;
+}
+
+/**
+ * Buffer is cache line aligned, which plain new does not guarantee before
+ * C++17. Over-allocate and keep the original pointer just in front of the
+ * aligned object.
+ */
+void* rng_t::operator new( size_t size )
+{
+  void* raw = ::operator new( size + BUFFER_ALIGN + sizeof( void* ) );
+  uintptr_t aligned = ( reinterpret_cast<uintptr_t>( raw ) + sizeof( void* ) + BUFFER_ALIGN - 1 ) & ~( uintptr_t( BUFFER_ALIGN ) - 1 );
+  reinterpret_cast<void**>( aligned )[ -1 ] = raw;
+  return reinterpret_cast<void*>( aligned );
+}
+
+void rng_t::operator delete( void* p )
+{
+  if ( p )
+    ::operator delete( static_cast<void**>( p )[ -1 ] );
+}
+
 // ==========================================================================
 // Probability Distributions
 // ==========================================================================
@@ -645,7 +956,97 @@ double rng_t::range( double min, double max )
 }
 
 /**
- * @brief Gaussian Distribution
+ * @brief Standard normal distribution, ziggurat method
+ *
+ * One uniform number picks both the layer ( top 7 bits ) and the position
+ * inside it ( the remaining 45 bits ). About 99% of the samples are accepted
+ * right away, without any transcendental function.
+ */
+double rng_t::std_normal()
+{
+  assert( ziggurat.initialized && "rng tables are set up by rng::create()" );
+
+  const int n = ziggurat_t::NORMAL_LAYERS;
+  // Sign by lookup, a branch on a random bit mispredicts half the time
+  static const double sign[ 2 ] = { 1.0, -1.0 };
+
+  for ( ;; )
+  {
+    double d = real() * ( 2 * n );
+    int i = static_cast<int>( d );
+    double u = d - i;          // [0,1)
+    double s = sign[ i / n ];
+    i &= n - 1;
+
+    if ( u < ziggurat.normal_ratio[ i ] )
+      return s * u * ziggurat.normal_x[ i ];
+
+    if ( i == 0 )
+    {
+      // Tail beyond R, Marsaglia 1964
+      double x, y;
+      do
+      {
+        x = std::log( 1.0 - real() ) / ZIGGURAT_NORMAL_R;
+        y = std::log( 1.0 - real() );
+      }
+      while ( -2.0 * y < x * x );
+      return s * ( ZIGGURAT_NORMAL_R - x );
+    }
+
+    // Wedge between the layer rectangle and the density
+    double x = u * ziggurat.normal_x[ i ];
+    double f = ziggurat.normal_f[ i ] + real() * ( ziggurat.normal_f[ i + 1 ] - ziggurat.normal_f[ i ] );
+    if ( f < std::exp( -0.5 * x * x ) )
+      return s * x;
+  }
+}
+
+/// Standard exponential distribution, ziggurat method
+double rng_t::std_exponential()
+{
+  assert( ziggurat.initialized && "rng tables are set up by rng::create()" );
+
+  const int n = ziggurat_t::EXP_LAYERS;
+
+  for ( ;; )
+  {
+    double d = real() * n;
+    int i = static_cast<int>( d );
+    double u = d - i;          // [0,1)
+
+    if ( u < ziggurat.exp_ratio[ i ] )
+      return u * ziggurat.exp_x[ i ];
+
+    // Tail beyond R is R plus an exponential, memorylessness
+    if ( i == 0 )
+      return ZIGGURAT_EXP_R - std::log( 1.0 - real() );
+
+    double x = u * ziggurat.exp_x[ i ];
+    double f = ziggurat.exp_f[ i ] + real() * ( ziggurat.exp_f[ i + 1 ] - ziggurat.exp_f[ i ] );
+    if ( f < std::exp( -x ) )
+      return x;
+  }
+}
+
+/// Gaussian Distribution
+double rng_t::gauss( double mean, double stddev, bool truncate_low_end )
+{
+  double z = stddev != 0 ? std_normal() : 0.0;
+
+  double result = mean + z * stddev;
+
+  // True gaussian distribution can of course yield any number at some probability.  So truncate on the low end.
+  if ( truncate_low_end && result < 0 )
+    result = 0;
+
+  return result;
+}
+
+/**
+ * @brief Gaussian Distribution, polar method
+ *
+ * Reference implementation for gauss(), to compare against.
  *
  * This code adapted from ftp://ftp.taygeta.com/pub/c/boxmuller.c
  * Implements the Polar form of the Box-Muller Transformation
@@ -655,10 +1056,8 @@ double rng_t::range( double min, double max )
  *     this software for any application provided this
  *     copyright notice is preserved.
  */
-double rng_t::gauss( double mean, double stddev, bool truncate_low_end )
+double rng_t::gauss_polar( double mean, double stddev )
 {
-
-  
   double z;
 
   if ( stddev != 0 )
@@ -691,17 +1090,17 @@ double rng_t::gauss( double mean, double stddev, bool truncate_low_end )
   else
     z = 0.0;
 
-  double result = mean + z * stddev;
-
-  // True gaussian distribution can of course yield any number at some probability.  So truncate on the low end.
-  if ( truncate_low_end && result < 0 )
-    result = 0;
-
-  return result;
+  return mean + z * stddev;
 }
 
 /// Exponential Distribution
 double rng_t::exponential( double nu )
+{
+  return std_exponential() * nu;
+}
+
+/// Exponential Distribution, inversion method. Reference implementation for exponential().
+double rng_t::exponential_inversion( double nu )
 {
   double x;
   do { x = real(); } while ( x >= 1.0 ); // avoid ln(0)
@@ -738,6 +1137,12 @@ timespan_t rng_t::exgauss( timespan_t mean, timespan_t stddev, timespan_t nu )
              static_cast<double>( timespan_t::to_native( nu ) ) ) );
 }
 
+/// Seed the stream of ( seed, iteration, actor, stream )
+void rng_t::seed_stream( uint64_t seed, uint64_t iteration, uint64_t actor, uint64_t stream )
+{
+  this -> seed( stream_seed( seed, iteration, actor, stream ) );
+}
+
 /// Reseed using current state
 uint64_t rng_t::reseed()
 {
@@ -756,7 +1161,7 @@ void rng_t::reset()
 }
 
 rng_t::rng_t() :
-    gauss_pair_value( 0.0 ), gauss_pair_use( false )
+    buffer_pos( BUFFER_SIZE ), gauss_pair_value( 0.0 ), gauss_pair_use( false )
 {
 }
 
@@ -774,6 +1179,7 @@ rng_t::type_e parse_type( const std::string& n )
   if( n == "xorshift64"   ) return rng_t::XORSHIFT64;
   if( n == "xorshift128"  ) return rng_t::XORSHIFT128;
   if( n == "xorshift1024" ) return rng_t::XORSHIFT1024;
+  if( n == "philox"       ) return rng_t::PHILOX;
 
   return rng_t::DEFAULT;
 }
@@ -783,28 +1189,33 @@ rng_t::type_e parse_type( const std::string& n )
  */
 std::unique_ptr<rng_t> create( rng_t::type_e t )
 {
+  init_ziggurat();
+
   switch( t )
   {
   case rng_t::MURMURHASH:
-    return std::unique_ptr<rng_t>(new rng_murmurhash_t());
+    return std::unique_ptr<rng_t>(new rng_engine_t<rng_murmurhash_t>());
 
   case rng_t::STD:
-    return std::unique_ptr<rng_t>(new rng_mt_cxx11_t());
+    return std::unique_ptr<rng_t>(new rng_engine_t<rng_mt_cxx11_t>());
 
   case rng_t::SFMT:
-    return std::unique_ptr<rng_t>(new rng_sfmt_t());
+    return std::unique_ptr<rng_t>(new rng_engine_t<rng_sfmt_t>());
 
   case rng_t::TINYMT:
-    return std::unique_ptr<rng_t>(new rng_tinymt_t());
+    return std::unique_ptr<rng_t>(new rng_engine_t<rng_tinymt_t>());
 
   case rng_t::XORSHIFT64:
-    return std::unique_ptr<rng_t>(new rng_xorshift64_t());
+    return std::unique_ptr<rng_t>(new rng_engine_t<rng_xorshift64_t>());
 
   case rng_t::XORSHIFT128:
-    return std::unique_ptr<rng_t>(new rng_xorshift128_t());
+    return std::unique_ptr<rng_t>(new rng_engine_t<rng_xorshift128_t>());
 
   case rng_t::XORSHIFT1024:
-    return std::unique_ptr<rng_t>(new rng_xorshift1024_t());
+    return std::unique_ptr<rng_t>(new rng_engine_t<rng_xorshift1024_t>());
+
+  case rng_t::PHILOX:
+    return std::unique_ptr<rng_t>(new rng_engine_t<rng_philox_t>());
 
   case rng_t::DEFAULT:
   default:
@@ -814,6 +1225,35 @@ std::unique_ptr<rng_t> create( rng_t::type_e t )
   return create( rng_t::SFMT );
 }
 
+/**
+ * @brief Seed of a random stream, keyed by iteration, actor and purpose
+ *
+ * Each non-zero key component is folded in with the SplitMix64 finalizer, one
+ * after the other. Every position is scaled by its own odd constant, so
+ * swapping components ( iteration 5, actor 0 vs. iteration 0, actor 5 ) gives
+ * a different stream. A zero component leaves the seed alone, so
+ * stream_seed( s, i, a, p ) == stream_seed( stream_seed( s, i ), 0, a, p ):
+ * an iteration can be replayed on its own with its stream_seed as the seed.
+ */
+uint64_t stream_seed( uint64_t seed, uint64_t iteration, uint64_t actor, uint64_t stream )
+{
+  const uint64_t key[ 3 ] = { iteration, actor, stream };
+  const uint64_t scale[ 3 ] = { 0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL };
+
+  for ( size_t i = 0; i < 3; i++ )
+  {
+    if ( key[ i ] == 0 )
+      continue;
+
+    uint64_t z = seed + key[ i ] * scale[ i ];
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+    seed = z ^ ( z >> 31 );
+  }
+
+  return seed;
+}
+
 /**
  * @brief The standard normal CDF, for one random variable.
  *
@@ -1039,6 +1479,257 @@ static void test_seed( rng_t* rng, uint64_t n )
                ", numbers/sec = " << static_cast<uint64_t>( n * 1000.0 / elapsed_cpu ) << "\n\n";
 }
 
+// Buffered front-end has to hand out exactly the engine sequence, also
+// across a seed() in the middle of a buffer.
+template <typename Engine>
+static bool test_buffer( uint64_t seed )
+{
+  rng_engine_t<Engine>* rng = new rng_engine_t<Engine>();
+  rng_engine_t<Engine>* unbuffered = new rng_engine_t<Engine>();
+  Engine& reference = unbuffered -> engine;
+  bool ok = true;
+
+  for ( unsigned pass = 0; pass < 2; ++pass )
+  {
+    rng -> seed( seed + pass );
+    reference.seed( seed + pass );
+    for ( size_t i = 0; i < 10 * rng_t::BUFFER_SIZE + 3; ++i )
+    {
+      if ( rng -> real() != reference.real() )
+      {
+        ok = false;
+        break;
+      }
+    }
+  }
+
+  std::cout << "buffered " << rng -> name() << ( ok ? " matches" : " DIFFERS FROM" ) << " engine sequence\n";
+  delete rng;
+  delete unbuffered;
+  return ok;
+}
+
+// Philox known answers ( Random123 kat_vectors ), replaying a stream of an
+// iteration from the iteration's stream_seed, and distinct seeds for all keys
+// of a small ( iteration, actor, stream ) grid, including permuted ones.
+static bool test_streams( uint64_t seed )
+{
+  bool ok = true;
+
+  std::vector<uint64_t> seeds;
+  for ( uint64_t i = 0; i < 16; i++ )
+    for ( uint64_t a = 0; a < 16; a++ )
+      for ( uint64_t p = 0; p < 16; p++ )
+        seeds.push_back( stream_seed( seed, i, a, p ) );
+  std::sort( seeds.begin(), seeds.end() );
+  bool distinct = std::adjacent_find( seeds.begin(), seeds.end() ) == seeds.end();
+  std::cout << "stream seeds of " << seeds.size() << " keys " << ( distinct ? "distinct" : "COLLIDE" ) << "\n";
+  ok &= distinct;
+
+  const uint32_t zero[ 4 ] = { 0, 0, 0, 0 }, ones[ 4 ] = { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff };
+  const uint32_t kat_zero[ 4 ] = { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 };
+  const uint32_t kat_ones[ 4 ] = { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd };
+  uint32_t r[ 4 ];
+  rng_philox_t::block( zero, zero, r );
+  ok &= std::equal( r, r + 4, kat_zero );
+  rng_philox_t::block( ones, ones, r );
+  ok &= std::equal( r, r + 4, kat_ones );
+  std::cout << "philox known answers " << ( ok ? "match" : "DIFFER" ) << "\n";
+
+  rng_t::type_e types[ 2 ] = { rng_t::SFMT, rng_t::PHILOX };
+  for ( rng_t::type_e t : types )
+  {
+    std::unique_ptr<rng_t> a = create( t ), b = create( t );
+    bool replay = true, disjoint = true;
+
+    for ( uint64_t actor = 0; actor < 4; actor++ )
+    {
+      a -> seed_stream( seed, 17, actor, 3 );
+      b -> seed_stream( stream_seed( seed, 17 ), 0, actor, 3 );
+      for ( size_t i = 0; i < 1000; i++ )
+        replay &= a -> real() == b -> real();
+
+      a -> seed_stream( seed, 17, actor, 3 );
+      b -> seed_stream( seed, 17, actor + 1, 3 );
+      size_t same = 0;
+      for ( size_t i = 0; i < 1000; i++ )
+        same += a -> real() == b -> real();
+      disjoint &= same == 0;
+
+      // Same actor in the next iteration, and the key with iteration and
+      // actor swapped
+      a -> seed_stream( seed, actor + 1, actor, 3 );
+      b -> seed_stream( seed, actor + 2, actor, 3 );
+      same = 0;
+      for ( size_t i = 0; i < 1000; i++ )
+        same += a -> real() == b -> real();
+      disjoint &= same == 0;
+
+      a -> seed_stream( seed, actor + 1, 0, 3 );
+      b -> seed_stream( seed, 0, actor + 1, 3 );
+      same = 0;
+      for ( size_t i = 0; i < 1000; i++ )
+        same += a -> real() == b -> real();
+      disjoint &= same == 0;
+    }
+
+    std::cout << a -> name() << " streams: replay " << ( replay ? "ok" : "FAILED" )
+              << ", actor streams " << ( disjoint ? "disjoint" : "OVERLAP" ) << "\n";
+    ok &= replay && disjoint;
+  }
+
+  return ok;
+}
+
+// Moments and tail frequencies of a sample
+struct moments_t
+{
+  uint64_t n;
+  double sum[ 4 ];
+  uint64_t tail[ 3 ];
+  double tail_at[ 3 ];
+
+  moments_t( double t0, double t1, double t2 ) : n( 0 )
+  {
+    sum[ 0 ] = sum[ 1 ] = sum[ 2 ] = sum[ 3 ] = 0;
+    tail[ 0 ] = tail[ 1 ] = tail[ 2 ] = 0;
+    tail_at[ 0 ] = t0; tail_at[ 1 ] = t1; tail_at[ 2 ] = t2;
+  }
+
+  void add( double x, double tail_x )
+  {
+    ++n;
+    sum[ 0 ] += x; sum[ 1 ] += x * x; sum[ 2 ] += x * x * x; sum[ 3 ] += x * x * x * x;
+    for ( int i = 0; i < 3; i++ )
+      tail[ i ] += tail_x > tail_at[ i ];
+  }
+
+  double mean() const { return sum[ 0 ] / n; }
+  double variance() const { return sum[ 1 ] / n - mean() * mean(); }
+  double skewness() const
+  {
+    double m = mean(), v = variance();
+    return ( sum[ 2 ] / n - 3 * m * sum[ 1 ] / n + 2 * m * m * m ) / ( v * std::sqrt( v ) );
+  }
+  double kurtosis() const
+  {
+    double m = mean(), v = variance();
+    return ( sum[ 3 ] / n - 4 * m * sum[ 2 ] / n + 6 * m * m * sum[ 1 ] / n - 3 * m * m * m * m ) / ( v * v );
+  }
+  double tail_p( int i ) const { return static_cast<double>( tail[ i ] ) / n; }
+};
+
+// Compare the moments and tails of a sample with the exact ones. A moment
+// passes within 6 standard errors of its estimate, a tail frequency within 6
+// binomial standard errors.
+static bool check_moments( const char* label, const moments_t& m, const double exact[ 4 ], const double exact_tail[ 3 ], int64_t elapsed_cpu )
+{
+  // Standard errors of mean, variance, skewness and kurtosis estimates, to
+  // first order for the normal distribution, widened for the exponential.
+  double se[ 4 ] = { std::sqrt( exact[ 1 ] / m.n ), exact[ 1 ] * std::sqrt( 8.0 / m.n ),
+                     std::sqrt( 200.0 / m.n ), std::sqrt( 5000.0 / m.n ) };
+  bool ok = true;
+
+  std::cout << std::setprecision( 5 ) << std::fixed << label << ": ";
+  const char* names[ 4 ] = { "mean", "var", "skew", "kurt" };
+  double values[ 4 ] = { m.mean(), m.variance(), m.skewness(), m.kurtosis() };
+  for ( int i = 0; i < 4; i++ )
+  {
+    bool pass = std::fabs( values[ i ] - exact[ i ] ) < 6 * se[ i ];
+    ok &= pass;
+    std::cout << names[ i ] << "=" << values[ i ] << ( pass ? " " : "! " );
+  }
+  std::cout << std::scientific << std::setprecision( 3 );
+  for ( int i = 0; i < 3; i++ )
+  {
+    double p = exact_tail[ i ];
+    bool pass = std::fabs( m.tail_p( i ) - p ) < 6 * std::sqrt( p * ( 1 - p ) / m.n ) + 1.0 / m.n;
+    ok &= pass;
+    std::cout << "P(>" << std::setprecision( 0 ) << std::fixed << m.tail_at[ i ] << ")="
+              << std::scientific << std::setprecision( 3 ) << m.tail_p( i ) << ( pass ? " " : "! " );
+  }
+  std::cout << std::defaultfloat << "time=" << elapsed_cpu << " ms\n";
+
+  return ok;
+}
+
+// Ziggurat samplers against the exact distributions and the reference
+// implementations, plus throughput.
+static bool test_distributions( rng_t* rng, uint64_t n )
+{
+  bool ok = true;
+
+  // normal: mean, variance, skewness, kurtosis; P(|z|>2), P(|z|>3), P(|z|>4)
+  const double normal[ 4 ] = { 0, 1, 0, 3 };
+  const double normal_tail[ 3 ] = { 4.5500263896e-2, 2.6997960633e-3, 6.3342483666e-5 };
+  // exponential: P(x>3), P(x>5), P(x>8) = exp( -x )
+  const double exponential[ 4 ] = { 1, 1, 2, 9 };
+  const double exponential_tail[ 3 ] = { std::exp( -3.0 ), std::exp( -5.0 ), std::exp( -8.0 ) };
+
+  std::cout << n << " samples, " << rng -> name() << "\n";
+
+  for ( int method = 0; method < 2; method++ )
+  {
+    moments_t m( 2, 3, 4 );
+    int64_t start_time = milliseconds();
+    for ( uint64_t i = 0; i < n; i++ )
+    {
+      double z = method == 0 ? rng -> gauss( 0, 1 ) : rng -> gauss_polar( 0, 1 );
+      m.add( z, std::fabs( z ) );
+    }
+    ok &= check_moments( method == 0 ? "gauss ziggurat" : "gauss polar   ", m, normal, normal_tail, milliseconds() - start_time );
+  }
+
+  for ( int method = 0; method < 2; method++ )
+  {
+    moments_t m( 3, 5, 8 );
+    int64_t start_time = milliseconds();
+    for ( uint64_t i = 0; i < n; i++ )
+    {
+      double x = method == 0 ? rng -> exponential( 1 ) : rng -> exponential_inversion( 1 );
+      m.add( x, x );
+    }
+    ok &= check_moments( method == 0 ? "exp ziggurat  " : "exp inversion ", m, exponential, exponential_tail, milliseconds() - start_time );
+  }
+
+  // Far tail of the exponential ziggurat ( beyond R = 7.7 ) is a separate code path
+  {
+    uint64_t beyond = 0;
+    for ( uint64_t i = 0; i < n; i++ )
+      beyond += rng -> exponential( 1 ) > 10.0;
+    double p = std::exp( -10.0 );
+    bool pass = std::fabs( static_cast<double>( beyond ) / n - p ) < 6 * std::sqrt( p / n ) + 1.0 / n;
+    std::cout << "exp ziggurat P(>10)=" << std::scientific << static_cast<double>( beyond ) / n << ( pass ? "" : "!" )
+              << " exact=" << p << std::defaultfloat << "\n\n";
+    ok &= pass;
+  }
+
+  // Throughput alone
+  const char* labels[ 4 ] = { "gauss ziggurat", "gauss polar", "exponential ziggurat", "exponential inversion" };
+  for ( int method = 0; method < 4; method++ )
+  {
+    int64_t start_time = milliseconds();
+    double sum = 0;
+    for ( uint64_t i = 0; i < n; i++ )
+    {
+      switch ( method )
+      {
+        case 0: sum += rng -> gauss( 0, 1 ); break;
+        case 1: sum += rng -> gauss_polar( 0, 1 ); break;
+        case 2: sum += rng -> exponential( 1 ); break;
+        default: sum += rng -> exponential_inversion( 1 ); break;
+      }
+    }
+    int64_t elapsed_cpu = std::max( int64_t( 1 ), milliseconds() - start_time );
+    std::cout << n << " calls to " << labels[ method ] << ", sum = " << std::setprecision( 8 ) << sum
+              << ", time = " << elapsed_cpu << " ms"
+                 ", numbers/sec = " << static_cast<uint64_t>( n * 1000.0 / elapsed_cpu ) << "\n";
+  }
+  std::cout << "\n";
+
+  return ok;
+}
+
 // Monte-Carlo PI calculation.
 static void monte_carlo( rng_t* rng, uint64_t n )
 {
@@ -1066,13 +1757,16 @@ static void monte_carlo( rng_t* rng, uint64_t n )
 int main( int /*argc*/, char** /*argv*/ )
 {
   using namespace rng;
-  rng_t* rng_mt_cxx11   = new rng_mt_cxx11_t();
-  rng_t* rng_mt_cxx11_64   = new rng_mt_cxx11_64_t();
-  rng_t* rng_murmurhash   = new rng_murmurhash_t();
-  rng_t* rng_sfmt   = new rng_sfmt_t();
-  rng_t* rng_tinymt = new rng_tinymt_t();
-  rng_t* rng_xs128  = new rng_xorshift128_t();
-  rng_t* rng_xs1024 = new rng_xorshift1024_t();
+  init_ziggurat();
+
+  rng_t* rng_mt_cxx11   = new rng_engine_t<rng_mt_cxx11_t>();
+  rng_t* rng_mt_cxx11_64   = new rng_engine_t<rng_mt_cxx11_64_t>();
+  rng_t* rng_murmurhash   = new rng_engine_t<rng_murmurhash_t>();
+  rng_t* rng_sfmt   = new rng_engine_t<rng_sfmt_t>();
+  rng_t* rng_tinymt = new rng_engine_t<rng_tinymt_t>();
+  rng_t* rng_xs128  = new rng_engine_t<rng_xorshift128_t>();
+  rng_t* rng_xs1024 = new rng_engine_t<rng_xorshift1024_t>();
+  rng_t* rng_philox = new rng_engine_t<rng_philox_t>();
 
   std::random_device rd;
   uint64_t seed  = uint64_t(rd()) | (uint64_t(rd()) << 32);
@@ -1086,6 +1780,23 @@ int main( int /*argc*/, char** /*argv*/ )
   rng_tinymt -> seed( seed );
   rng_xs128  -> seed( seed );
   rng_xs1024 -> seed( seed );
+  rng_philox -> seed( seed );
+
+  bool ok = test_buffer<rng_mt_cxx11_t>( seed );
+  ok &= test_buffer<rng_mt_cxx11_64_t>( seed );
+  ok &= test_buffer<rng_murmurhash_t>( seed + ( seed == 0 ) );
+  ok &= test_buffer<rng_sfmt_t>( seed );
+  ok &= test_buffer<rng_tinymt_t>( seed );
+  ok &= test_buffer<rng_xorshift64_t>( seed + ( seed == 0 ) );
+  ok &= test_buffer<rng_xorshift128_t>( seed );
+  ok &= test_buffer<rng_xorshift1024_t>( seed );
+  ok &= test_buffer<rng_philox_t>( seed );
+  ok &= test_streams( seed );
+  std::cout << "\n";
+  ok &= test_distributions( rng_sfmt, 10000000 );
+  std::cout << "\n";
+  if ( ! ok )
+    return 1;
 
   uint64_t n = 100000000;
 
@@ -1096,6 +1807,7 @@ int main( int /*argc*/, char** /*argv*/ )
   test_one( rng_tinymt, n );
   test_one( rng_xs128,  n );
   test_one( rng_xs1024, n );
+  test_one( rng_philox, n );
 
   monte_carlo( rng_mt_cxx11,   n );
   monte_carlo( rng_murmurhash,   n );
@@ -1103,6 +1815,7 @@ int main( int /*argc*/, char** /*argv*/ )
   monte_carlo( rng_tinymt, n );
   monte_carlo( rng_xs128,  n );
   monte_carlo( rng_xs1024, n );
+  monte_carlo( rng_philox, n );
 
   test_seed( rng_mt_cxx11,   100000 );
   test_seed( rng_murmurhash,   100000 );
@@ -1110,6 +1823,7 @@ int main( int /*argc*/, char** /*argv*/ )
   test_seed( rng_tinymt, 100000 );
   test_seed( rng_xs128,  100000 );
   test_seed( rng_xs1024, 100000 );
+  test_seed( rng_philox, 100000 );
 
 
   std::cout << "random device: min=" << rd.min() << " max=" << rd.max() << "\n\n";
@@ -9,6 +9,7 @@
 /*! \defgroup SC_RNG Random Number Generator */
 
 #include "config.hpp"
+#include <cstddef>
 #include <memory>
 #include "sc_timespan.hpp"
 
@@ -21,22 +22,37 @@ namespace rng {
  *
  * Implements different rng-engines, selectable through a factory,
  * as well as different distribution outputs ( uniform, gauss, etc. )
+ *
+ * Uniform numbers are generated by the engine in blocks and handed out from a
+ * buffer, so real() and everything built on it is a non-virtual inline call.
  */
 struct rng_t
 {
   /// rng engines
-  enum type_e { DEFAULT, MURMURHASH, SFMT, STD, TINYMT, XORSHIFT64, XORSHIFT128, XORSHIFT1024 };
+  enum type_e { DEFAULT, MURMURHASH, SFMT, STD, TINYMT, XORSHIFT64, XORSHIFT128, XORSHIFT1024, PHILOX };
+
+  /// numbers generated per engine call
+  static const size_t BUFFER_SIZE = 128;
+  static const size_t BUFFER_ALIGN = 64;
 
   virtual ~rng_t() {}
   /// name of rng engine
   virtual const char* name() const = 0;
-  /// seed rng engine
+  /// seed rng engine, discards buffered numbers
   virtual void seed( uint64_t start ) = 0;
-  /// uniform distribution in range [0,1]
-  virtual double real() = 0;
+  /// seed the stream of ( seed, iteration, actor, stream ), see stream_seed()
+  virtual void seed_stream( uint64_t seed, uint64_t iteration, uint64_t actor = 0, uint64_t stream = 0 );
   virtual uint64_t reseed();
   virtual void reset();
 
+  /// uniform distribution in range [0,1)
+  double real()
+  {
+    if ( buffer_pos == BUFFER_SIZE )
+      refill();
+    return buffer[ buffer_pos++ ];
+  }
+
   bool roll( double chance );
   double range( double min, double max );
   double gauss( double mean, double stddev, bool truncate_low_end = false );
@@ -45,10 +61,27 @@ struct rng_t
   timespan_t range( timespan_t min, timespan_t max );
   timespan_t gauss( timespan_t mean, timespan_t stddev );
   timespan_t exgauss( timespan_t mean, timespan_t stddev, timespan_t nu );
+
+  /// reference implementations of gauss() and exponential(), for testing
+  double gauss_polar( double mean, double stddev );
+  double exponential_inversion( double nu );
+
+  static void* operator new( size_t size );
+  static void operator delete( void* p );
 protected:
   rng_t();
+  /// fill block with uniform numbers in range [0,1) from the engine
+  virtual void generate( double* block, size_t n ) = 0;
+  void discard_buffer();
 private:
-  // Allow re-use of unused ( but necessary ) random number of a previous call to gauss()  
+  void refill();
+  double std_normal();
+  double std_exponential();
+
+  alignas( BUFFER_ALIGN ) double buffer[ BUFFER_SIZE ];
+  size_t buffer_pos;
+
+  // Allow re-use of unused ( but necessary ) random number of a previous call to gauss_polar()
   double gauss_pair_value; 
   bool   gauss_pair_use;
 
@@ -56,6 +89,7 @@ private:
 
 std::unique_ptr<rng_t> create( rng_t::type_e = rng_t::DEFAULT );
 rng_t::type_e parse_type( const std::string& name );
+uint64_t stream_seed( uint64_t seed, uint64_t iteration, uint64_t actor = 0, uint64_t stream = 0 );
 
 double stdnormal_cdf( double );
 double stdnormal_inv( double );
@@ -1,6 +1,131 @@
 #ifdef UNIT_TEST
 #include "sample_data.hpp"
 #include <iostream>
+#include <ctime>
+
+namespace {
+
+// Compare sketch percentiles against the exact ones, and check that a sketch
+// merged from two halves equals the sketch of all samples.
+bool test_quantile_sketch( double accuracy )
+{
+  extended_sample_data_t exact( "exact", false );
+  extended_sample_data_t sketch( "sketch", false );
+  extended_sample_data_t half1( "half1", false ), half2( "half2", false );
+  sketch.use_sketch( accuracy );
+  half1.use_sketch( accuracy );
+  half2.use_sketch( accuracy );
+
+  for ( int i = 0; i < 100000; ++i )
+  {
+    // Skewed, DPS-like distribution with a few zeroes
+    double x = i % 1000 == 0 ? 0.0 : 50000.0 + 20000.0 * std::pow( rand() / ( RAND_MAX + 1.0 ), 3 );
+    exact.add( x );
+    sketch.add( x );
+    ( i % 2 ? half1 : half2 ).add( x );
+  }
+  half1.merge( half2 );
+
+  exact.analyze_all();
+  sketch.analyze_all();
+  half1.analyze_all();
+
+  bool ok = true;
+  double max_error = 0;
+  for ( double q = 0; q <= 1.0; q += 0.01 )
+  {
+    double e = exact.percentile( q ), s = sketch.percentile( q );
+    double error = e != 0 ? std::fabs( s - e ) / std::fabs( e ) : std::fabs( s );
+    max_error = std::max( max_error, error );
+    if ( error > accuracy * ( 1 + 1e-9 ) )
+      ok = false;
+    if ( s != half1.percentile( q ) )
+      ok = false;
+  }
+
+  std::cout << "quantile sketch: accuracy=" << accuracy
+            << " buckets=" << sketch.sketch().num_buckets()
+            << " max_error=" << max_error
+            << " mean=" << sketch.mean() << " (exact " << exact.mean() << ")"
+            << " std_dev=" << sketch.std_dev << " (exact " << exact.std_dev << ")"
+            << ( ok ? " ok" : " FAILED" ) << "\n";
+  return ok;
+}
+
+// Online ( Welford ) and merged ( Chan ) variance against the two-pass formula
+bool test_online_variance()
+{
+  std::vector<double> samples;
+  simple_sample_data_t all, half1, half2;
+  for ( int i = 0; i < 100000; ++i )
+  {
+    double x = 1e6 + 1000.0 * ( rand() / ( RAND_MAX + 1.0 ) );
+    samples.push_back( x );
+    all.add( x );
+    ( i < 30000 ? half1 : half2 ).add( x );
+  }
+  half1.merge( half2 );
+
+  double exact = statistics::calculate_variance( samples.begin(), samples.end() );
+  bool ok = std::fabs( all.online_variance() - exact ) < 1e-9 * exact &&
+            std::fabs( half1.online_variance() - exact ) < 1e-9 * exact;
+
+  std::cout << "online variance: " << all.online_variance() << " merged " << half1.online_variance()
+            << " (two-pass " << exact << ")" << ( ok ? " ok" : " FAILED" ) << "\n";
+  return ok;
+}
+
+// Min and max of negative samples, before and after clearing the data
+bool test_min_max_negative()
+{
+  extended_sample_data_t z( "negative", false );
+  bool ok = true;
+  for ( int pass = 0; pass < 2; ++pass )
+  {
+    z.add( -5.0 );
+    z.add( -3.0 );
+    ok = ok && z.min() == -5.0 && z.max() == -3.0;
+    z.clear();
+  }
+
+  std::cout << "min/max of negative samples" << ( ok ? " ok" : " FAILED" ) << "\n";
+  return ok;
+}
+
+double seconds_since( std::clock_t start )
+{ return static_cast<double>( std::clock() - start ) / CLOCKS_PER_SEC; }
+
+// Time add, merge and analyze_all for the three sample data modes
+void benchmark( const std::string& mode, size_t n )
+{
+  extended_sample_data_t a( mode, mode == "simple" ), b( mode, mode == "simple" );
+  if ( mode == "sketch" )
+  {
+    a.use_sketch( 0.005 );
+    b.use_sketch( 0.005 );
+  }
+  a.reserve( n );
+  b.reserve( n / 2 );
+
+  std::clock_t start = std::clock();
+  for ( size_t i = 0; i < n; ++i )
+    ( i < n / 2 ? a : b ).add( 50000.0 + ( i * 7919 ) % 20000 );
+  double add_time = seconds_since( start );
+
+  start = std::clock();
+  a.merge( b );
+  double merge_time = seconds_since( start );
+
+  start = std::clock();
+  a.analyze_all();
+  double analyze_time = seconds_since( start );
+
+  std::cout << "benchmark " << mode << ": n=" << n
+            << " add=" << add_time << "s merge=" << merge_time << "s analyze=" << analyze_time << "s"
+            << " mean=" << a.mean() << " std_dev=" << a.std_dev << "\n";
+}
+
+} // unnamed namespace
 
 int main( int /*argc*/, char** /*argv*/ )
 {
@@ -16,6 +141,16 @@ int main( int /*argc*/, char** /*argv*/ )
   std::ostringstream s;
   z.data_str( s );
   std::cout << s.str();
-  return 0;
+
+  bool ok = test_quantile_sketch( 0.005 );
+  ok = test_quantile_sketch( 0.01 ) && ok;
+  ok = test_online_variance() && ok;
+  ok = test_min_max_negative() && ok;
+
+  benchmark( "simple", 10000000 );
+  benchmark( "sketch", 10000000 );
+  benchmark( "full", 10000000 );
+
+  return ok ? 0 : 1;
 }
 #endif // UNIT_TEST
@@ -10,6 +10,8 @@
 #include <numeric>
 #include <limits>
 #include <sstream>
+#include <cmath>
+#include <cstdint>
 #include "util/generic.hpp"
 
 /* Collection of statistical formulas for sequences
@@ -263,8 +265,9 @@ std::vector<double> create_normalized_histogram( iterator begin, iterator end, s
 } // end sd namespace
 
 
-/* Simplest Samplest Data container. Only tracks sum and count
- *
+/* Simplest Samplest Data container. Tracks sum and count, as well as the
+ * running mean and sum of squared deviations ( Welford ), so the variance is
+ * available in a single pass without keeping the samples.
  */
 class simple_sample_data_t
 {
@@ -274,15 +277,26 @@ protected:
   static const bool SAMPLE_DATA_NO_NAN = true;
   value_t _sum;
   size_t _count;
+  value_t _running_mean, _m2;
 
   static value_t nan()
   { return SAMPLE_DATA_NO_NAN ? value_t() : std::numeric_limits<value_t>::quiet_NaN(); }
 
 public:
-  simple_sample_data_t() : _sum(), _count() {}
+  simple_sample_data_t() : _sum(), _count(), _running_mean(), _m2() {}
+
+  // Rebuild a sample set from its running statistics
+  simple_sample_data_t( value_t sum, size_t count, value_t running_mean, value_t m2 ) :
+    _sum( sum ), _count( count ), _running_mean( running_mean ), _m2( m2 ) {}
 
   void add( double x )
-  { _sum += x; ++_count; }
+  {
+    _sum += x; ++_count;
+
+    value_t delta = x - _running_mean;
+    _running_mean += delta / _count;
+    _m2 += delta * ( x - _running_mean );
+  }
 
   value_t mean() const
   { return _count ? _sum / _count : nan(); }
@@ -296,9 +310,29 @@ public:
   size_t count() const
   { return _count; }
 
+  // Expected value of the squared deviation from the mean, as tracked online
+  value_t online_variance() const
+  { return _count > 1 ? _m2 / _count : value_t(); }
+
+  value_t running_mean() const
+  { return _running_mean; }
+
+  // Sum of squared deviations from the running mean
+  value_t m2() const
+  { return _m2; }
+
+  // Combine the running statistics of both sample sets ( Chan et al. )
   void merge( const simple_sample_data_t& other )
   {
-    _count += other._count;
+    if ( other._count == 0 )
+      return;
+
+    size_t n = _count + other._count;
+    value_t delta = other._running_mean - _running_mean;
+    _running_mean += delta * other._count / n;
+    _m2 += other._m2 + delta * delta * ( static_cast<value_t>( _count ) * other._count / n );
+
+    _count = n;
     _sum  += other._sum;
   }
 
@@ -306,6 +340,8 @@ public:
   {
     _count = 0;
     _sum = 0;
+    _running_mean = 0;
+    _m2 = 0;
   }
 };
 
@@ -327,7 +363,7 @@ public:
   simple_sample_data_with_min_max_t() :
     base_t(), _found( false ),
     _min( std::numeric_limits<value_t>::max() ),
-    _max( -std::numeric_limits<value_t>::min() )
+    _max( std::numeric_limits<value_t>::lowest() )
   {
 
   }
@@ -367,9 +403,227 @@ public:
   }
 };
 
-/* Extensive sample_data container with two runtime dependent modes:
+/* Mergeable streaming quantile sketch with bounded memory.
+ *
+ * Samples are counted in logarithmic buckets, bucket i holding the values in
+ * ( gamma^(i-1), gamma^i ] with gamma = ( 1 + a ) / ( 1 - a ), a being the
+ * relative accuracy (DDSketch). Zero and negative samples go to a zero count
+ * and a mirrored bucket store. Every quantile is reported within a relative
+ * error of a of the exact quantile of the samples added, and a histogram bin
+ * can only be wrong for samples within a relative distance of a from a bin
+ * edge.
+ *
+ * Each bucket store keeps at most max_buckets buckets; on overflow, the
+ * buckets closest to zero are collapsed into one. That only degrades the
+ * quantiles falling into the collapsed bucket, and takes a value range of
+ * gamma^max_buckets (about 1e8 for the default a = 0.5%) to happen.
+ *
+ * Merging adds bucket counts, so it is exact and independent of merge order.
+ */
+class quantile_sketch_t
+{
+public:
+  typedef double value_t;
+
+private:
+  // Dense run of bucket counts, starting at bucket index 'offset'
+  struct store_t
+  {
+    std::vector<uint64_t> counts;
+    int offset;
+    uint64_t total;
+
+    store_t() : offset( 0 ), total( 0 ) {}
+
+    int max_index() const
+    { return offset + static_cast<int>( counts.size() ) - 1; }
+
+    void add( int index, uint64_t n, size_t max_buckets )
+    {
+      if ( counts.empty() )
+      {
+        offset = index;
+        counts.push_back( 0 );
+      }
+
+      // Collapse the lowest buckets if the store would grow too wide
+      int low_limit = std::max( index, max_index() ) - static_cast<int>( max_buckets ) + 1;
+      if ( index < low_limit )
+        index = low_limit;
+      if ( offset < low_limit )
+      {
+        size_t excess = std::min( static_cast<size_t>( low_limit - offset ), counts.size() );
+        uint64_t folded = std::accumulate( counts.begin(), counts.begin() + excess, uint64_t() );
+        counts.erase( counts.begin(), counts.begin() + excess );
+        offset = low_limit;
+        if ( counts.empty() )
+          counts.push_back( 0 );
+        counts.front() += folded;
+      }
+
+      if ( index < offset )
+      {
+        counts.insert( counts.begin(), offset - index, 0 );
+        offset = index;
+      }
+      else if ( index > max_index() )
+      {
+        counts.resize( index - offset + 1, 0 );
+      }
+
+      counts[ index - offset ] += n;
+      total += n;
+    }
+
+    void merge( const store_t& other, size_t max_buckets )
+    {
+      for ( size_t i = 0; i < other.counts.size(); ++i )
+      {
+        if ( other.counts[ i ] )
+          add( other.offset + static_cast<int>( i ), other.counts[ i ], max_buckets );
+      }
+    }
+
+    void clear()
+    { counts.clear(); offset = 0; total = 0; }
+  };
+
+  double _accuracy, gamma, log_gamma;
+  size_t max_buckets;
+  store_t positive, negative;
+  uint64_t zero_count;
+  value_t _min, _max;
+
+  int index( value_t x ) const
+  { return static_cast<int>( std::ceil( std::log( x ) / log_gamma ) ); }
+
+  value_t bucket_value( int i ) const
+  { return 2.0 * std::pow( gamma, i ) / ( gamma + 1.0 ); }
+
+  // Calls f( value, count ) for all buckets, in ascending order of value
+  template <typename F>
+  void for_each_bucket( F f ) const
+  {
+    for ( int i = negative.max_index(); i >= negative.offset && ! negative.counts.empty(); --i )
+    {
+      if ( uint64_t n = negative.counts[ i - negative.offset ] )
+        f( -bucket_value( i ), n );
+    }
+    if ( zero_count )
+      f( value_t(), zero_count );
+    for ( size_t i = 0; i < positive.counts.size(); ++i )
+    {
+      if ( uint64_t n = positive.counts[ i ] )
+        f( bucket_value( positive.offset + static_cast<int>( i ) ), n );
+    }
+  }
+
+public:
+  quantile_sketch_t( double relative_accuracy = 0.005, size_t buckets = 2048 ) :
+    _accuracy(), gamma(), log_gamma(), max_buckets( buckets ), zero_count( 0 ),
+    _min( std::numeric_limits<value_t>::max() ), _max( -std::numeric_limits<value_t>::max() )
+  { set_accuracy( relative_accuracy ); }
+
+  // Changing the accuracy discards all samples
+  void set_accuracy( double relative_accuracy )
+  {
+    assert( relative_accuracy > 0 && relative_accuracy < 1 );
+    _accuracy = relative_accuracy;
+    gamma = ( 1.0 + relative_accuracy ) / ( 1.0 - relative_accuracy );
+    log_gamma = std::log( gamma );
+    clear();
+  }
+
+  double accuracy() const
+  { return _accuracy; }
+
+  void add( value_t x )
+  {
+    if ( x > std::numeric_limits<value_t>::min() )
+      positive.add( index( x ), 1, max_buckets );
+    else if ( x < -std::numeric_limits<value_t>::min() )
+      negative.add( index( -x ), 1, max_buckets );
+    else
+      ++zero_count;
+
+    if ( x < _min ) _min = x;
+    if ( x > _max ) _max = x;
+  }
+
+  uint64_t count() const
+  { return positive.total + negative.total + zero_count; }
+
+  size_t num_buckets() const
+  { return positive.counts.size() + negative.counts.size() + ( zero_count ? 1 : 0 ); }
+
+  // Quantile q in [0,1], clamped to the exact min/max of the samples
+  value_t quantile( double q ) const
+  {
+    uint64_t n = count();
+    if ( n == 0 )
+      return value_t();
+
+    uint64_t rank = static_cast<uint64_t>( q * ( n - 1 ) );
+    uint64_t seen = 0;
+    value_t result = _max;
+    bool found = false;
+    for_each_bucket( [ & ]( value_t v, uint64_t c ) {
+      if ( ! found && seen + c > rank )
+      {
+        result = v;
+        found = true;
+      }
+      seen += c;
+    } );
+
+    return clamp( result, _min, _max );
+  }
+
+  std::vector<size_t> histogram( size_t num_buckets, value_t min, value_t max ) const
+  {
+    std::vector<size_t> result;
+    value_t range = max - min;
+    if ( count() == 0 || range <= value_t() )
+      return result;
+
+    result.assign( num_buckets, size_t() );
+    for_each_bucket( [ & ]( value_t v, uint64_t c ) {
+      double position = ( clamp( v, min, max ) - min ) / range;
+      size_t index = std::min( static_cast<size_t>( num_buckets * position ), num_buckets - 1 );
+      result[ index ] += static_cast<size_t>( c );
+    } );
+
+    return result;
+  }
+
+  void merge( const quantile_sketch_t& other )
+  {
+    assert( gamma == other.gamma );
+
+    positive.merge( other.positive, max_buckets );
+    negative.merge( other.negative, max_buckets );
+    zero_count += other.zero_count;
+    if ( other._min < _min ) _min = other._min;
+    if ( other._max > _max ) _max = other._max;
+  }
+
+  void clear()
+  {
+    positive.clear();
+    negative.clear();
+    zero_count = 0;
+    _min = std::numeric_limits<value_t>::max();
+    _max = -std::numeric_limits<value_t>::max();
+  }
+};
+
+/* Extensive sample_data container with three runtime dependent modes:
  * - simple: Only offers sum, count
  *  -!simple: saves data and offers variance, percentiles, distribution, etc.
+ *  -sketch: !simple, but instead of saving data, feeds a quantile_sketch_t.
+ *           Offers the same statistics with bounded memory, percentiles and
+ *           distribution within the relative accuracy of the sketch, but no
+ *           access to the individual samples through data().
  */
 class extended_sample_data_t : public simple_sample_data_with_min_max_t
 {
@@ -384,6 +638,8 @@ private:
   std::vector<value_t> _data;
   std::vector<value_t*> _sorted_data; // extra sequence so we can keep the original, unsorted order ( for example to do regression on it )
   bool is_sorted;
+  bool sketched;
+  quantile_sketch_t _sketch;
 public:
   extended_sample_data_t( const std::string& n, bool s = true ) :
     base_t(),
@@ -394,21 +650,40 @@ public:
     mean_variance(),
     mean_std_dev(),
     simple( s ),
-    is_sorted( false )
+    is_sorted( false ),
+    sketched( false ),
+    _sketch()
   {}
 
   void change_mode( bool simple )
   {
     this -> simple = simple;
+    sketched = false;
 
     clear();
   }
 
+  // Switch to sketch mode with the given relative accuracy of percentiles
+  void use_sketch( double relative_accuracy )
+  {
+    simple = false;
+    sketched = true;
+    _sketch.set_accuracy( relative_accuracy );
+
+    clear();
+  }
+
+  bool is_sketch() const
+  { return sketched; }
+
+  const quantile_sketch_t& sketch() const
+  { return _sketch; }
+
   const char* name() const { return name_str.c_str(); }
 
   // Reserve memory
   void reserve( std::size_t capacity )
-  { if ( ! simple ) _data.reserve( capacity ); }
+  { if ( ! simple && ! sketched ) _data.reserve( capacity ); }
 
   // Add a sample
   void add( value_t x )
@@ -417,8 +692,14 @@ public:
     {
       base_t::add( x );
     }
+    else if ( sketched )
+    {
+      base_t::add( x );
+      _sketch.add( x );
+    }
     else
     {
+      base_t::add( x );
       _data.push_back( x );
       is_sorted = false;
     }
@@ -429,7 +710,7 @@ public:
 
   size_t size() const
   {
-    if ( simple )
+    if ( simple || sketched )
       return base_t::count();
 
     return _data.size();
@@ -459,21 +740,20 @@ public:
     if ( simple )
       return;
 
-    size_t sample_size = data().size();
+    size_t sample_size = count();
     if ( sample_size == 0 )
       return;
 
-    if ( sorted() )
-    { // If we have sorted data, we can just take the front/back as min/max
+    // Sum, count, min and max are tracked when adding, so only sorted data
+    // is rescanned: summing in sorted order makes the result independent of
+    // the order in which the samples of different threads were merged.
+    if ( sorted() && ! sketched )
+    {
       base_t::set_min( *_sorted_data.front() );
       base_t::set_max( *_sorted_data.back() );
-      base_t::_sum = statistics::calculate_sum( data().begin(), data().end() );
-    }
-    else
-    {
-      base_t::set_min( *std::min_element( data().begin(), data().end() ) );
-      base_t::set_max( *std::max_element( data().begin(), data().end() ) );
-      base_t::_sum = statistics::calculate_sum( data().begin(), data().end() );
+      base_t::_sum = value_t();
+      for ( size_t i = 0; i < sample_size; ++i )
+        base_t::_sum += *_sorted_data[ i ];
     }
 
     _mean = base_t::_sum / sample_size;
@@ -484,22 +764,32 @@ public:
   value_t pretty_mean() const
   { return simple ? base_t::pretty_mean() : _mean; }
   size_t count() const
-  { return simple ? base_t::count() : data().size(); }
+  { return ( simple || sketched ) ? base_t::count() : data().size(); }
 
   /* Analyze Variance: Variance, Stddev and Stddev of the mean
+   * Uses the variance tracked online, except for sorted data, where a pass
+   * in sorted order keeps the result independent of the merge order.
    * Requires: Analyzed Mean
    */
   void analyze_variance()
   {
-    if ( simple )
-      return;
-
-    size_t sample_size = data().size();
+    size_t sample_size = count();
 
     if ( sample_size == 0 )
       return;
 
-    variance = statistics::calculate_variance( data().begin(), data().end(), mean() );
+    if ( simple || sketched || ! sorted() )
+    {
+      variance = base_t::online_variance();
+    }
+    else
+    {
+      variance = value_t();
+      for ( size_t i = 0; i < sample_size; ++i )
+        variance += ( *_sorted_data[ i ] - mean() ) * ( *_sorted_data[ i ] - mean() );
+      if ( sample_size > 1 )
+        variance /= sample_size;
+    }
     std_dev = std::sqrt( variance );
 
     // Calculate Standard Deviation of the Mean ( Central Limit Theorem )
@@ -522,7 +812,11 @@ public:
   // sort data
   void sort()
   {
-    if ( ! is_sorted && !simple )
+    if ( sketched )
+    {
+      is_sorted = true; // Sketch buckets are ordered by value
+    }
+    else if ( ! is_sorted && !simple )
     {
       _sorted_data.resize( _data.size() );
       for ( size_t i = 0; i < _data.size(); ++i )
@@ -541,14 +835,29 @@ public:
     if ( simple )
       return;
 
-    if ( data().empty() )
+    if ( count() == 0 )
       return;
 
-    distribution = statistics::create_histogram( data().begin(), data().end(), num_buckets, base_t::min(), base_t::max() );
+    distribution = histogram( num_buckets, base_t::min(), base_t::max() );
+  }
+
+  // Histogram ( not normalized ) of the data with the given bounds
+  std::vector<size_t> histogram( size_t num_buckets, value_t min, value_t max ) const
+  {
+    if ( sketched )
+      return _sketch.histogram( num_buckets, min, max );
+
+    return statistics::create_histogram( data().begin(), data().end(), num_buckets, min, max );
   }
 
   void clear()
-  { base_t::_count = 0; base_t::_sum = 0.0; _sorted_data.clear(); _data.clear(); distribution.clear();  }
+  {
+    base_t::reset(); _sorted_data.clear(); _data.clear(); distribution.clear();
+    base_t::_found = false;
+    base_t::_min = std::numeric_limits<value_t>::max();
+    base_t::_max = std::numeric_limits<value_t>::lowest();
+    _sketch.clear();
+  }
 
   // Access functions
 
@@ -560,6 +869,9 @@ public:
     if ( simple )
       return 0;
 
+    if ( sketched )
+      return _sketch.quantile( x );
+
     if ( data().empty() )
       return 0;
 
@@ -577,11 +889,13 @@ public:
   {
     assert( simple == other.simple );
 
-    if ( simple )
-    {
-      base_t::merge( other );
-    }
-    else
+    assert( sketched == other.sketched );
+
+    base_t::merge( other );
+
+    if ( sketched )
+      _sketch.merge( other._sketch );
+    else if ( ! simple )
       _data.insert( _data.end(), other._data.begin(), other._data.end() );
   }
 
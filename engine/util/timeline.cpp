@@ -1,13 +1,373 @@
+// ==========================================================================
+// Dedmonwakeen's Raid DPS/TPS Simulator.
+// Send questions to natehieter@gmail.com
+// ==========================================================================
+
 #include "timeline.hpp"
-#include <iostream>
+
+// Vectorized timeline kernels ==============================================
+
+#if defined(__SSE2__) || ( defined( SC_VS ) && ( defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) ) )
+#  define TIMELINE_USE_SSE2
+#  include <emmintrin.h>
+#endif
+
+// AVX2 kernels are compiled for x86 regardless of the baseline instruction
+// set, and only called after checking the CPU at runtime.
+#if ( defined( SC_GCC ) && SC_GCC >= 40900 ) || ( defined( SC_CLANG ) && SC_CLANG >= 30800 )
+#  if defined( __x86_64__ ) || defined( __i386__ )
+#    define TIMELINE_USE_AVX2
+#    define TIMELINE_AVX2_TARGET __attribute__(( target( "avx2" ) ))
+#    include <immintrin.h>
+#  endif
+#elif defined( SC_VS ) && SC_VS >= 12 && ( defined(_M_X64) || defined(_M_IX86) )
+#  define TIMELINE_USE_AVX2
+#  define TIMELINE_AVX2_TARGET
+#  include <immintrin.h>
+#  include <intrin.h>
+#endif
+
+namespace {
+
+struct kernels_t
+{
+  void ( *add )( double*, const double*, size_t );
+  void ( *divide )( double*, const double*, size_t );
+  void ( *window_difference )( const double*, size_t, size_t, double, double* );
+  const char* name;
+};
+
+// Scalar =====================================================================
+
+void add_scalar( double* dst, const double* src, size_t n )
+{
+  for ( size_t i = 0; i < n; ++i )
+    dst[ i ] += src[ i ];
+}
+
+void divide_scalar( double* dst, const double* divisor, size_t n )
+{
+  for ( size_t i = 0; i < n; ++i )
+    dst[ i ] /= divisor[ i ];
+}
+
+// out[ i ] = ( sums[ i + window ] - sums[ i ] ) / window, for i in [0,n)
+void window_difference_scalar( const double* sums, size_t n, size_t window, double divisor, double* out )
+{
+  for ( size_t i = 0; i < n; ++i )
+    out[ i ] = ( sums[ i + window ] - sums[ i ] ) / divisor;
+}
+
+// SSE2 =======================================================================
+
+#if defined( TIMELINE_USE_SSE2 )
+void add_sse2( double* dst, const double* src, size_t n )
+{
+  size_t i = 0;
+  for ( ; i + 2 <= n; i += 2 )
+    _mm_storeu_pd( dst + i, _mm_add_pd( _mm_loadu_pd( dst + i ), _mm_loadu_pd( src + i ) ) );
+  add_scalar( dst + i, src + i, n - i );
+}
+
+void divide_sse2( double* dst, const double* divisor, size_t n )
+{
+  size_t i = 0;
+  for ( ; i + 2 <= n; i += 2 )
+    _mm_storeu_pd( dst + i, _mm_div_pd( _mm_loadu_pd( dst + i ), _mm_loadu_pd( divisor + i ) ) );
+  divide_scalar( dst + i, divisor + i, n - i );
+}
+
+void window_difference_sse2( const double* sums, size_t n, size_t window, double divisor, double* out )
+{
+  __m128d d = _mm_set1_pd( divisor );
+  size_t i = 0;
+  for ( ; i + 2 <= n; i += 2 )
+  {
+    __m128d x = _mm_sub_pd( _mm_loadu_pd( sums + i + window ), _mm_loadu_pd( sums + i ) );
+    _mm_storeu_pd( out + i, _mm_div_pd( x, d ) );
+  }
+  window_difference_scalar( sums + i, n - i, window, divisor, out + i );
+}
+#endif
+
+// AVX2 =======================================================================
+
+#if defined( TIMELINE_USE_AVX2 )
+TIMELINE_AVX2_TARGET void add_avx2( double* dst, const double* src, size_t n )
+{
+  size_t i = 0;
+  for ( ; i + 4 <= n; i += 4 )
+    _mm256_storeu_pd( dst + i, _mm256_add_pd( _mm256_loadu_pd( dst + i ), _mm256_loadu_pd( src + i ) ) );
+  for ( ; i < n; ++i )
+    dst[ i ] += src[ i ];
+}
+
+TIMELINE_AVX2_TARGET void divide_avx2( double* dst, const double* divisor, size_t n )
+{
+  size_t i = 0;
+  for ( ; i + 4 <= n; i += 4 )
+    _mm256_storeu_pd( dst + i, _mm256_div_pd( _mm256_loadu_pd( dst + i ), _mm256_loadu_pd( divisor + i ) ) );
+  for ( ; i < n; ++i )
+    dst[ i ] /= divisor[ i ];
+}
+
+TIMELINE_AVX2_TARGET void window_difference_avx2( const double* sums, size_t n, size_t window, double divisor, double* out )
+{
+  __m256d d = _mm256_set1_pd( divisor );
+  size_t i = 0;
+  for ( ; i + 4 <= n; i += 4 )
+  {
+    __m256d x = _mm256_sub_pd( _mm256_loadu_pd( sums + i + window ), _mm256_loadu_pd( sums + i ) );
+    _mm256_storeu_pd( out + i, _mm256_div_pd( x, d ) );
+  }
+  for ( ; i < n; ++i )
+    out[ i ] = ( sums[ i + window ] - sums[ i ] ) / divisor;
+}
+
+bool cpu_has_avx2()
+{
+#if defined( SC_VS )
+  int info[ 4 ];
+  __cpuid( info, 0 );
+  if ( info[ 0 ] < 7 )
+    return false;
+  __cpuid( info, 1 );
+  bool osxsave = ( info[ 2 ] & ( 1 << 27 ) ) != 0;
+  bool avx = ( info[ 2 ] & ( 1 << 28 ) ) != 0;
+  if ( ! osxsave || ! avx || ( _xgetbv( 0 ) & 6 ) != 6 ) // OS saves YMM state
+    return false;
+  __cpuidex( info, 7, 0 );
+  return ( info[ 1 ] & ( 1 << 5 ) ) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+}
+#endif
+
+kernels_t select_kernels()
+{
+#if defined( TIMELINE_USE_AVX2 )
+  if ( cpu_has_avx2() )
+  {
+    kernels_t k = { add_avx2, divide_avx2, window_difference_avx2, "avx2" };
+    return k;
+  }
+#endif
+#if defined( TIMELINE_USE_SSE2 )
+  kernels_t k = { add_sse2, divide_sse2, window_difference_sse2, "sse2" };
+#else
+  kernels_t k = { add_scalar, divide_scalar, window_difference_scalar, "scalar" };
+#endif
+  return k;
+}
+
+const kernels_t& kernels()
+{
+  static const kernels_t k = select_kernels();
+  return k;
+}
+
+} // unnamed namespace
+
+namespace timeline_kernels {
+
+void add( double* dst, const double* src, size_t n )
+{ kernels().add( dst, src, n ); }
+
+void divide( double* dst, const double* divisor, size_t n )
+{ kernels().divide( dst, divisor, n ); }
+
+/* Same result as the generic sliding_window_average(), computed from prefix
+ * sums so that the interior of the output, where the window is fully inside
+ * the data, is a vectorizable difference of two shifted sequences.
+ *
+ * The result is not bit-identical to summing each window: the rounding error
+ * of a window is relative to the prefix sum up to it, not to the window
+ * itself. Averages of non-negative data are clamped at 0, so that error can
+ * never show as a negative value.
+ */
+void sliding_window_average( const double* data, size_t n, unsigned window, double* out )
+{
+  if ( n == 0 )
+    return;
+
+  size_t w = window;
+  if ( n < w || w == 0 )
+  {
+    // input is pathologically small compared to window size, just average everything.
+    std::fill_n( out, n, std::accumulate( data, data + n, 0.0 ) / n );
+    return;
+  }
+
+  size_t half = w / 2;
+
+  std::vector<double> sums( n + 1 );
+  sums[ 0 ] = 0.0;
+  bool non_negative = true;
+  for ( size_t i = 0; i < n; ++i )
+  {
+    sums[ i + 1 ] = sums[ i ] + data[ i ];
+    non_negative &= data[ i ] >= 0;
+  }
+
+  // Left edge: window clipped at the start of the data
+  size_t left_end = w - half - 1;
+  for ( size_t i = 0; i < left_end; ++i )
+    out[ i ] = sums[ i + half + 1 ] / w;
+
+  // Interior: out[ i ] = ( sums[ i + half + 1 ] - sums[ i + half + 1 - w ] ) / w
+  kernels().window_difference( sums.data() + left_end + half + 1 - w, n - half - left_end, w, static_cast<double>( w ), out + left_end );
+
+  // Right edge: window clipped at the end of the data
+  for ( size_t i = n - half; i < n; ++i )
+    out[ i ] = ( sums[ n ] - sums[ i + half + 1 - w ] ) / w;
+
+  if ( non_negative )
+  {
+    for ( size_t i = 0; i < n; ++i )
+      out[ i ] = std::max( out[ i ], 0.0 );
+  }
+}
+
+const char* isa()
+{ return kernels().name; }
+
+} // namespace timeline_kernels
+
 #ifdef UNIT_TEST
+#include <iostream>
+#include <ctime>
+#include <cstdlib>
+#include <cmath>
 
-int main( int /*argc*/, char** /*argv*/ )
+namespace {
+
+bool near( double a, double b, double scale = 1.0 )
+{ return std::fabs( a - b ) <= 1e-9 * std::max( scale, std::fabs( b ) ); }
+
+// Compare the kernels against the generic implementations for many sizes
+bool test_kernels()
 {
-  tl::timeline_t<double> x;
+  bool ok = true;
+  for ( size_t n = 0; n < 300; n += ( n < 20 ? 1 : 37 ) )
+  {
+    std::vector<double> a( n ), b( n );
+    for ( size_t i = 0; i < n; ++i )
+    {
+      a[ i ] = rand() % 10000;
+      b[ i ] = 1 + rand() % 100;
+    }
 
-  std::cout << sizeof( double );
+    std::vector<double> sum = a, quotient = a;
+    timeline_kernels::add( sum.data(), b.data(), n );
+    timeline_kernels::divide( quotient.data(), b.data(), n );
+    for ( size_t i = 0; i < n; ++i )
+      ok = ok && near( sum[ i ], a[ i ] + b[ i ] ) && near( quotient[ i ], a[ i ] / b[ i ] );
+
+    // The prefix sum version rounds differently from summing each window.
+    // Its error is relative to the running sum of the input, so allow 1e-9
+    // of the whole input's sum as absolute tolerance.
+    double total = std::accumulate( a.begin(), a.end(), 0.0 );
+    for ( unsigned window = 1; window < 12; ++window )
+    {
+      std::vector<double> expected, actual( n );
+      sliding_window_average( a, window, std::back_inserter( expected ) );
+      timeline_kernels::sliding_window_average( a.data(), n, window, actual.data() );
+      for ( size_t i = 0; i < n; ++i )
+        ok = ok && near( actual[ i ], expected[ i ], total );
+    }
+  }
+
+  // A spike followed by small values must not average below 0
+  std::vector<double> spike( 64, 0.1 ), average( spike.size() );
+  spike[ 3 ] = 1e17;
+  spike[ 4 ] = 3.7;
+  for ( unsigned window = 2; window < 12; ++window )
+  {
+    timeline_kernels::sliding_window_average( spike.data(), spike.size(), window, average.data() );
+    for ( size_t i = 0; i < average.size(); ++i )
+      ok = ok && average[ i ] >= 0;
+  }
+  std::cout << "timeline kernels (" << timeline_kernels::isa() << "): " << ( ok ? "ok" : "FAILED" ) << "\n";
+  return ok;
+}
+
+// Adds below the reserved length must not reallocate, overlong ones are counted
+bool test_reserve()
+{
+  timeline_t tl;
+  tl.reserve( 100 );
+  for ( size_t i = 0; i < 100; ++i )
+    tl.add( i, 1.0 );
+  bool ok = tl.overflow_count() == 0 && tl.data().size() == 100;
+
+  tl.add( 150, 2.0 );
+  ok = ok && tl.overflow_count() == 1 && tl.data().size() == 151 && tl.data()[ 150 ] == 2.0 && tl.data()[ 120 ] == 0.0;
+
+  timeline_t other;
+  other.add( 0, 1.0 );
+  tl.merge( other );
+  ok = ok && tl.overflow_count() == 2 && tl.data()[ 0 ] == 2.0;
+
+  std::cout << "timeline reserve: " << ( ok ? "ok" : "FAILED" ) << "\n";
+  return ok;
+}
+
+double seconds_since( std::clock_t start )
+{ return static_cast<double>( std::clock() - start ) / CLOCKS_PER_SEC; }
+
+void benchmark()
+{
+  const size_t n = 1000, repeat = 200000;
+  timeline_t x, y, out;
+  for ( size_t i = 0; i < n; ++i )
+  {
+    x.add( i, 1.0 + i );
+    y.add( i, 2.0 + i );
+  }
+
+  std::clock_t start = std::clock();
+  for ( size_t r = 0; r < repeat; ++r )
+    x.merge( y );
+  double merge_time = seconds_since( start );
+
+  start = std::clock();
+  for ( size_t r = 0; r < repeat / 10; ++r )
+  {
+    out.clear();
+    x.build_sliding_average_timeline( out, 20 );
+  }
+  double window_time = seconds_since( start );
+
+  // generic reference implementation
+  start = std::clock();
+  for ( size_t r = 0; r < repeat / 10; ++r )
+  {
+    std::vector<double> reference;
+    reference.reserve( n );
+    sliding_window_average( x.data(), 20, std::back_inserter( reference ) );
+  }
+  double generic_window_time = seconds_since( start );
+
+  start = std::clock();
+  for ( size_t r = 0; r < repeat; ++r )
+    x.adjust( y.data() );
+  double adjust_time = seconds_since( start );
+
+  std::cout << "timeline benchmark (" << timeline_kernels::isa() << ", " << n << " buckets): merge=" << merge_time
+            << "s adjust=" << adjust_time << "s sliding_average=" << window_time
+            << "s (generic " << generic_window_time << "s)\n";
+}
+
+} // unnamed namespace
+
+int main( int /*argc*/, char** /*argv*/ )
+{
+  bool ok = test_kernels();
+  ok = test_reserve() && ok;
+  benchmark();
 
-  return 0;
+  return ok ? 0 : 1;
 }
 #endif // UNIT_TEST
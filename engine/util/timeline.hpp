@@ -71,14 +71,42 @@ inline Range& sliding_window_average( Range& r, unsigned window, Out out )
   return r;
 }
 
+/* Vectorized kernels for the timeline hot loops, implemented in timeline.cpp.
+ * The instruction set ( AVX2 if the cpu supports it, SSE2 or plain scalar
+ * code otherwise ) is selected once at runtime.
+ */
+namespace timeline_kernels {
+// dst[ i ] += src[ i ]
+void add( double* dst, const double* src, size_t n );
+// dst[ i ] /= divisor[ i ]
+void divide( double* dst, const double* divisor, size_t n );
+// Same output as sliding_window_average( data, data + n, window, out )
+void sliding_window_average( const double* data, size_t n, unsigned window, double* out );
+// Name of the selected instruction set
+const char* isa();
+}
+
 // generic Timeline class
 class timeline_t
 {
 private:
   std::vector<double> _data;
+  size_t _overflows; // number of add() calls which had to reallocate
+
+  // Slow path of add(): grow up to index, reallocating if it exceeds the reserved capacity
+  void add_slow( size_t index, double value )
+  {
+    if ( index >= _data.capacity() ) // we need to reallocate
+    {
+      ++_overflows;
+      _data.reserve( std::max( std::max( size_t( 10 ), _data.capacity() * 2 ), index + 1 ) );
+    }
+    _data.resize( index + 1 );
+    _data[ index ] += value;
+  }
 
 public:
-  timeline_t() : _data() {}
+  timeline_t() : _data(), _overflows() {}
 
   // const access to the underlying vector data
   const std::vector<double>& data() const
@@ -90,19 +118,21 @@ public:
   void resize( size_t length )
   { _data.resize( length ); }
 
+  // Preallocate storage for 'length' buckets, so that add() does not need to reallocate below it
+  void reserve( size_t length )
+  { _data.reserve( length ); }
+
+  // Number of add() calls which went past the reserved storage and had to reallocate
+  size_t overflow_count() const
+  { return _overflows; }
+
   // Add 'value' at the specific index
   void add( size_t index, double value )
   {
-    if ( index >= _data.capacity() ) // we need to reallocate
-    {
-      _data.reserve( std::max( size_t( 10 ), _data.capacity() * 2 ) );
-      _data.resize( index + 1 );
-    }
-    else if ( index >= _data.size() ) // we still have enough capacity left, but need to resize up to index
-    {
-      _data.resize( index + 1 );
-    }
-    _data.at( index ) += value;
+    if ( index < _data.size() )
+      _data[ index ] += value;
+    else
+      add_slow( index, value );
   }
 
   // Adjust timeline by dividing through divisor timeline
@@ -116,6 +146,9 @@ public:
     }
   }
 
+  void adjust( const std::vector<double>& divisor_timeline )
+  { timeline_kernels::divide( _data.data(), divisor_timeline.data(), std::min( _data.size(), divisor_timeline.size() ) ); }
+
   double mean() const
   { 
     if ( data().size() == 0 )
@@ -136,18 +169,20 @@ public:
   void merge( const timeline_t& other )
   {
     // merge shared range
-    for ( size_t j = 0, num_buckets = std::min( _data.size(), other.data().size() ); j < num_buckets; ++j )
-      _data[ j ] += other.data()[ j ];
+    timeline_kernels::add( _data.data(), other.data().data(), std::min( _data.size(), other.data().size() ) );
 
     // if other is larger, insert tail
     if ( _data.size() < other.data().size() )
       _data.insert( _data.end(), other.data().begin() + _data.size(), other.data().end() );
+
+    _overflows += other._overflows;
   }
 
   void build_sliding_average_timeline( timeline_t& out, unsigned window ) const
   {
-    out._data.reserve( data().size() );
-    sliding_window_average( data(), window, std::back_inserter( out._data ) );
+    size_t offset = out._data.size();
+    out._data.resize( offset + data().size() );
+    timeline_kernels::sliding_window_average( _data.data(), _data.size(), window, out._data.data() + offset );
   }
 
   // Maximum value; 0 if no data available
@@ -245,11 +280,11 @@ public:
    */
   void create_histogram( const extended_sample_data_t& sd, size_t num_buckets, double min, double max )
   {
-    if ( sd.simple || sd.data().empty() )
+    if ( sd.simple || sd.count() == 0 )
       return;
     clear();
     _min = min; _max = max;
-    _data = statistics::create_histogram( sd.data().begin(), sd.data().end(), num_buckets, _min, _max );
+    _data = sd.histogram( num_buckets, _min, _max );
     calculate_num_entries();
   }
 
@@ -257,8 +292,13 @@ public:
    */
   void create_histogram( const extended_sample_data_t& sd, size_t num_buckets )
   {
-    if ( sd.simple || sd.data().empty() )
+    if ( sd.simple || sd.count() == 0 )
       return;
+    if ( sd.is_sketch() )
+    {
+      create_histogram( sd, num_buckets, sd.sketch().quantile( 0.0 ), sd.sketch().quantile( 1.0 ) );
+      return;
+    }
     double min = *std::min_element( sd.data().begin(), sd.data().end() );
     double max = *std::max_element( sd.data().begin(), sd.data().end() );
     create_histogram( sd, num_buckets, min, max );
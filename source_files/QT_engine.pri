@@ -29,6 +29,7 @@
  HEADERS += engine/util/utf8/checked.h
  HEADERS += engine/util/utf8.h
  SOURCES += engine/util/xml.cpp
+ SOURCES += engine/util/timeline.cpp
  SOURCES += engine/util/str.cpp
  SOURCES += engine/util/rng.cpp
  SOURCES += engine/util/io.cpp
@@ -40,6 +41,7 @@
  SOURCES += engine/sim/sc_progress_bar.cpp
  SOURCES += engine/sim/sc_plot.cpp
  SOURCES += engine/sim/sc_option.cpp
+ SOURCES += engine/sim/sc_iteration_design.cpp
  SOURCES += engine/sim/sc_gear_stats.cpp
  SOURCES += engine/sim/sc_expressions.cpp
  SOURCES += engine/sim/sc_event.cpp
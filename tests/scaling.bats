@@ -0,0 +1,13 @@
+load test_helper
+
+@test "Scale factor sims merge the iterations of all threads" {
+  # Every thread runs a warm-up iteration on top of the iterations it claims
+  # from the work queue, so each merged sim reports 100 + 4 iterations.
+  sim threads=4 iterations=100 calculate_scale_factors=1 scale_only=agility debug_scale_factors=1
+  [ "${status}" -eq 0 ]
+  # Baseline, reference and delta sim each report the merged iteration count
+  reported=$(echo "${output}" | grep -c "Iterations    = ")
+  merged=$(echo "${output}" | grep -c "Iterations    = 104$")
+  [ "${reported}" -ge 3 ]
+  [ "${merged}" -eq "${reported}" ]
+}